@@ -0,0 +1,521 @@
+// vertex-benchmark -> load generator for a running vertex (or any RESP server)
+// C connections spread over T threads, each keeps up to P requests in flight (pipelining)
+// every reply is timed against the moment its request was written, percentiles are exact (sorted samples)
+//
+// g++ -std=c++20 -O2 -pthread bench/Benchmark.cpp -o vertex-benchmark
+// ./vertex-benchmark -c 50 -P 16 -n 1000000 --mix set:1,get:3 --value-size 64 --format json
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+enum class Op { Set, Get, Lpush, Lpop, Hset, Hgetall, Mget };
+
+struct OpName {
+    Op op;
+    const char* name;
+};
+
+static const OpName opNames[] = {
+    {Op::Set, "set"}, {Op::Get, "get"}, {Op::Lpush, "lpush"}, {Op::Lpop, "lpop"},
+    {Op::Hset, "hset"}, {Op::Hgetall, "hgetall"}, {Op::Mget, "mget"},
+};
+static const size_t OP_COUNT = sizeof(opNames) / sizeof(opNames[0]);
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 6440;
+    int clients = 50;
+    int pipeline = 1;
+    int threads = 1;
+    uint64_t requests = 100000;
+    std::vector<std::pair<Op, unsigned>> mix = {{Op::Set, 1}, {Op::Get, 1}}; //op, weight
+    uint64_t keyspace = 10000;
+    bool sequential = false;
+    size_t value_min = 64;
+    size_t value_max = 64;
+    int mget_keys = 10;
+    int hash_fields = 16;
+    std::string format = "text"; //text | csv | json
+};
+
+static std::string usage() {
+    return "usage: vertex-benchmark [-h host] [-p port] [-c clients] [-P pipeline] [-n requests] [--threads N]\n"
+           "                        [--mix cmd[:weight],...] (set get lpush lpop hset hgetall mget)\n"
+           "                        [--keyspace N] [--keys random|sequential] [--value-size N | MIN-MAX]\n"
+           "                        [--mget-keys N] [--hash-fields N] [--format text|csv|json]\n";
+}
+
+static bool parseNumber(const std::string& name, const std::string& text, uint64_t min, uint64_t& out) {
+    try {
+        size_t used = 0;
+        unsigned long long value = std::stoull(text, &used);
+        if (used != text.size() || value < min) throw std::invalid_argument(text);
+        out = value;
+        return true;
+    } catch (const std::exception&) {
+        std::cerr << "invalid value for " << name << ": " << text << "\n";
+        return false;
+    }
+}
+
+template <typename T>
+static bool parseNumber(const std::string& name, const std::string& text, uint64_t min, T& out) {
+    uint64_t value = 0;
+    if (!parseNumber(name, text, min, value)) return false;
+    out = static_cast<T>(value);
+    return true;
+}
+
+//"set:1,get:3" -> weights, a missing weight is 1
+static bool parseMix(const std::string& text, std::vector<std::pair<Op, unsigned>>& mix) {
+    mix.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        std::string item = text.substr(start, end - start);
+        std::string name = item.substr(0, item.find(':'));
+        unsigned weight = 1;
+        if (name.size() != item.size() && !parseNumber("--mix weight", item.substr(name.size() + 1), 1, weight))
+            return false;
+        for (char& c : name) c = static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+        const OpName* found = nullptr;
+        for (const auto& op : opNames)
+            if (name == op.name) found = &op;
+        if (!found) {
+            std::cerr << "unknown command in --mix: " << name << "\n";
+            return false;
+        }
+        mix.emplace_back(found->op, weight);
+        start = end + 1;
+    }
+    return !mix.empty();
+}
+
+static bool parseArgs(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help") return false;
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "-h" || arg == "--host") opt.host = value;
+        else if (arg == "-p" || arg == "--port") ok = parseNumber(arg, value, 1, opt.port);
+        else if (arg == "-c" || arg == "--clients") ok = parseNumber(arg, value, 1, opt.clients);
+        else if (arg == "-P" || arg == "--pipeline") ok = parseNumber(arg, value, 1, opt.pipeline);
+        else if (arg == "-n" || arg == "--requests") ok = parseNumber(arg, value, 1, opt.requests);
+        else if (arg == "--threads") ok = parseNumber(arg, value, 1, opt.threads);
+        else if (arg == "--mix") ok = parseMix(value, opt.mix);
+        else if (arg == "--keyspace") ok = parseNumber(arg, value, 1, opt.keyspace);
+        else if (arg == "--keys") {
+            ok = value == "random" || value == "sequential";
+            if (!ok) std::cerr << "--keys must be random or sequential\n";
+            opt.sequential = value == "sequential";
+        } else if (arg == "--value-size") {
+            size_t dash = value.find('-');
+            ok = parseNumber(arg, value.substr(0, dash), 0, opt.value_min);
+            opt.value_max = opt.value_min;
+            if (ok && dash != std::string::npos) ok = parseNumber(arg, value.substr(dash + 1), opt.value_min, opt.value_max);
+        }
+        else if (arg == "--mget-keys") ok = parseNumber(arg, value, 1, opt.mget_keys);
+        else if (arg == "--hash-fields") ok = parseNumber(arg, value, 1, opt.hash_fields);
+        else if (arg == "--format") {
+            ok = value == "text" || value == "csv" || value == "json";
+            if (!ok) std::cerr << "--format must be text, csv or json\n";
+            opt.format = value;
+        } else {
+            std::cerr << "unknown option: " << arg << "\n";
+            ok = false;
+        }
+        if (!ok) return false;
+    }
+    if (opt.threads > opt.clients) opt.threads = opt.clients;
+    return true;
+}
+
+//xorshift64*, one per thread
+struct Rng {
+    uint64_t state;
+    explicit Rng(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+};
+
+//length of one complete reply starting at pos, 0 -> not all there yet
+static size_t replyLength(std::string_view buf, size_t pos = 0) {
+    if (pos >= buf.size()) return 0;
+    size_t eol = buf.find("\r\n", pos);
+    if (eol == std::string_view::npos) return 0;
+    char type = buf[pos];
+    size_t end = eol + 2;
+    if (type == '+' || type == '-' || type == ':') return end - pos;
+    long long n = 0;
+    std::from_chars(buf.data() + pos + 1, buf.data() + eol, n);
+    if (type == '$') {
+        if (n < 0) return end - pos;
+        if (buf.size() < end + static_cast<size_t>(n) + 2) return 0;
+        return end + static_cast<size_t>(n) + 2 - pos;
+    }
+    if (type == '*') {
+        for (long long i = 0; i < n; i++) {
+            size_t len = replyLength(buf, end);
+            if (len == 0) return 0;
+            end += len;
+        }
+        return end - pos;
+    }
+    return end - pos; //unknown type, treat the line as the reply
+}
+
+//one connection: written requests wait in inflight until their reply comes back
+struct Client {
+    int fd = -1;
+    std::string out;
+    size_t out_sent = 0;
+    std::string in;
+    std::deque<std::pair<Op, Clock::time_point>> inflight;
+    uint64_t remaining = 0; //requests not issued yet
+};
+
+struct OpSamples {
+    std::vector<uint64_t> ns;
+    uint64_t errors = 0;
+};
+
+struct Worker {
+    const Options& opt;
+    std::vector<Client> clients;
+    std::vector<OpSamples> samples = std::vector<OpSamples>(OP_COUNT);
+    Rng rng;
+    uint64_t next_key = 0; //sequential keyspace cursor
+    std::string values;    //value_max bytes, values are prefixes of it
+    bool failed = false;
+    std::vector<unsigned> cumulative; //mix weights, running sum
+
+    Worker(const Options& o, uint64_t seed) : opt(o), rng(seed), values(o.value_max, 'x') {
+        unsigned sum = 0;
+        for (const auto& m : opt.mix) cumulative.push_back(sum += m.second);
+    }
+
+    uint64_t pickKey() {
+        if (opt.sequential) return next_key++ % opt.keyspace;
+        return rng.next() % opt.keyspace;
+    }
+
+    std::string_view pickValue() {
+        size_t len = opt.value_min;
+        if (opt.value_max > opt.value_min) len += rng.next() % (opt.value_max - opt.value_min + 1);
+        return std::string_view(values).substr(0, len);
+    }
+
+    Op pickOp() {
+        unsigned r = static_cast<unsigned>(rng.next() % cumulative.back());
+        size_t i = std::upper_bound(cumulative.begin(), cumulative.end(), r) - cumulative.begin();
+        return opt.mix[i].first;
+    }
+
+    static void bulk(std::string& out, std::string_view arg) {
+        out += '$';
+        out += std::to_string(arg.size());
+        out += "\r\n";
+        out += arg;
+        out += "\r\n";
+    }
+
+    static std::string keyName(const char* prefix, uint64_t n) {
+        char buf[48];
+        int len = std::snprintf(buf, sizeof(buf), "%s:%012llu", prefix, static_cast<unsigned long long>(n));
+        return std::string(buf, len);
+    }
+
+    void appendCommand(std::string& out, Op op) {
+        auto header = [&out](size_t argc) { out += '*'; out += std::to_string(argc); out += "\r\n"; };
+        switch (op) {
+        case Op::Set:
+            header(3); bulk(out, "SET"); bulk(out, keyName("key", pickKey())); bulk(out, pickValue());
+            break;
+        case Op::Get:
+            header(2); bulk(out, "GET"); bulk(out, keyName("key", pickKey()));
+            break;
+        case Op::Lpush:
+            header(3); bulk(out, "LPUSH"); bulk(out, keyName("list", pickKey())); bulk(out, pickValue());
+            break;
+        case Op::Lpop:
+            header(2); bulk(out, "LPOP"); bulk(out, keyName("list", pickKey()));
+            break;
+        case Op::Hset:
+            header(4); bulk(out, "HSET"); bulk(out, keyName("hash", pickKey()));
+            bulk(out, keyName("field", rng.next() % static_cast<uint64_t>(opt.hash_fields))); bulk(out, pickValue());
+            break;
+        case Op::Hgetall:
+            header(2); bulk(out, "HGETALL"); bulk(out, keyName("hash", pickKey()));
+            break;
+        case Op::Mget:
+            header(1 + opt.mget_keys); bulk(out, "MGET");
+            for (int i = 0; i < opt.mget_keys; i++) bulk(out, keyName("key", pickKey()));
+            break;
+        }
+    }
+
+    //tops the connection up to P in flight, one write for the whole batch
+    void refill(Client& c) {
+        Clock::time_point now = Clock::now();
+        while (c.remaining > 0 && c.inflight.size() < static_cast<size_t>(opt.pipeline)) {
+            Op op = pickOp();
+            appendCommand(c.out, op);
+            c.inflight.emplace_back(op, now);
+            c.remaining--;
+        }
+    }
+
+    bool flush(Client& c) {
+        while (c.out_sent < c.out.size()) {
+            ssize_t n = send(c.fd, c.out.data() + c.out_sent, c.out.size() - c.out_sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                c.out_sent += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true; //EPOLLOUT resumes
+            return false;
+        }
+        c.out.clear();
+        c.out_sent = 0;
+        return true;
+    }
+
+    //false -> connection broke
+    bool readReplies(Client& c) {
+        char buf[64 * 1024];
+        while (true) {
+            ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                c.in.append(buf, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return false;
+        }
+        Clock::time_point now = Clock::now();
+        size_t pos = 0;
+        while (!c.inflight.empty()) {
+            size_t len = replyLength(c.in, pos);
+            if (len == 0) break;
+            auto [op, sent] = c.inflight.front();
+            c.inflight.pop_front();
+            OpSamples& s = samples[static_cast<size_t>(op)];
+            s.ns.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent).count()));
+            if (c.in[pos] == '-') s.errors++;
+            pos += len;
+        }
+        c.in.erase(0, pos);
+        return true;
+    }
+
+    bool connectAll(const sockaddr_storage& addr, socklen_t addrLen) {
+        for (auto& c : clients) {
+            c.fd = socket(addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (c.fd < 0 || connect(c.fd, reinterpret_cast<const sockaddr*>(&addr), addrLen) < 0) {
+                std::cerr << "connect to " << opt.host << ":" << opt.port << " failed: " << strerror(errno) << "\n";
+                return false;
+            }
+            int one = 1;
+            setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            fcntl(c.fd, F_SETFL, fcntl(c.fd, F_GETFL) | O_NONBLOCK);
+        }
+        return true;
+    }
+
+    void run() {
+        int ep = epoll_create1(EPOLL_CLOEXEC);
+        size_t active = 0;
+        for (size_t i = 0; i < clients.size(); i++) {
+            Client& c = clients[i];
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+            ev.data.u64 = i;
+            epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+            refill(c);
+            if (!flush(c)) failed = true;
+            if (!c.inflight.empty()) active++;
+        }
+        std::vector<epoll_event> events(clients.size());
+        while (active > 0 && !failed) {
+            int n = epoll_wait(ep, events.data(), static_cast<int>(events.size()), 1000);
+            if (n < 0 && errno == EINTR) continue;
+            for (int i = 0; i < n; i++) {
+                Client& c = clients[events[i].data.u64];
+                if (c.inflight.empty() && c.remaining == 0) continue;
+                if ((events[i].events & EPOLLOUT) && !flush(c)) failed = true;
+                if (!(events[i].events & EPOLLIN)) continue;
+                if (!readReplies(c)) {
+                    std::cerr << "connection closed by server\n";
+                    failed = true;
+                    break;
+                }
+                refill(c);
+                if (!flush(c)) failed = true;
+                if (c.inflight.empty() && c.remaining == 0) active--;
+            }
+        }
+        close(ep);
+        for (auto& c : clients) close(c.fd);
+    }
+};
+
+struct Report {
+    const char* name;
+    uint64_t requests;
+    uint64_t errors;
+    double rps;
+    double avg_ms, p50_ms, p95_ms, p99_ms, p999_ms, max_ms;
+};
+
+static double percentileMs(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+    rank = std::clamp<size_t>(rank, 1, sorted.size());
+    return static_cast<double>(sorted[rank - 1]) / 1e6;
+}
+
+static Report makeReport(const char* name, std::vector<uint64_t>& ns, uint64_t errors, double seconds) {
+    std::sort(ns.begin(), ns.end());
+    Report r{name, ns.size(), errors, 0, 0, 0, 0, 0, 0, 0};
+    if (ns.empty()) return r;
+    r.rps = static_cast<double>(ns.size()) / seconds;
+    r.avg_ms = static_cast<double>(std::accumulate(ns.begin(), ns.end(), uint64_t(0))) / static_cast<double>(ns.size()) / 1e6;
+    r.p50_ms = percentileMs(ns, 50);
+    r.p95_ms = percentileMs(ns, 95);
+    r.p99_ms = percentileMs(ns, 99);
+    r.p999_ms = percentileMs(ns, 99.9);
+    r.max_ms = static_cast<double>(ns.back()) / 1e6;
+    return r;
+}
+
+static void printReports(const Options& opt, const std::vector<Report>& reports, double seconds) {
+    if (opt.format == "csv") {
+        std::printf("command,requests,errors,rps,avg_ms,p50_ms,p95_ms,p99_ms,p99.9_ms,max_ms\n");
+        for (const auto& r : reports)
+            std::printf("%s,%llu,%llu,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", r.name, static_cast<unsigned long long>(r.requests),
+                        static_cast<unsigned long long>(r.errors), r.rps, r.avg_ms, r.p50_ms, r.p95_ms, r.p99_ms, r.p999_ms, r.max_ms);
+        return;
+    }
+    if (opt.format == "json") {
+        std::printf("{\"clients\":%d,\"pipeline\":%d,\"threads\":%d,\"requests\":%llu,\"keyspace\":%llu,\"seconds\":%.3f,\"results\":[",
+                    opt.clients, opt.pipeline, opt.threads, static_cast<unsigned long long>(opt.requests),
+                    static_cast<unsigned long long>(opt.keyspace), seconds);
+        for (size_t i = 0; i < reports.size(); i++) {
+            const Report& r = reports[i];
+            std::printf("%s{\"command\":\"%s\",\"requests\":%llu,\"errors\":%llu,\"rps\":%.2f,\"avg_ms\":%.3f,\"p50_ms\":%.3f,"
+                        "\"p95_ms\":%.3f,\"p99_ms\":%.3f,\"p99.9_ms\":%.3f,\"max_ms\":%.3f}",
+                        i ? "," : "", r.name, static_cast<unsigned long long>(r.requests), static_cast<unsigned long long>(r.errors),
+                        r.rps, r.avg_ms, r.p50_ms, r.p95_ms, r.p99_ms, r.p999_ms, r.max_ms);
+        }
+        std::printf("]}\n");
+        return;
+    }
+    std::printf("%llu requests, %d clients, pipeline %d, %d thread(s), keyspace %llu, %.2f seconds\n\n",
+                static_cast<unsigned long long>(opt.requests), opt.clients, opt.pipeline, opt.threads,
+                static_cast<unsigned long long>(opt.keyspace), seconds);
+    std::printf("%-8s %10s %8s %12s %9s %9s %9s %9s %9s %9s\n", "command", "requests", "errors", "rps",
+                "avg ms", "p50", "p95", "p99", "p99.9", "max");
+    for (const auto& r : reports)
+        std::printf("%-8s %10llu %8llu %12.2f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", r.name,
+                    static_cast<unsigned long long>(r.requests), static_cast<unsigned long long>(r.errors), r.rps,
+                    r.avg_ms, r.p50_ms, r.p95_ms, r.p99_ms, r.p999_ms, r.max_ms);
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        std::cerr << usage();
+        return 1;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(opt.host.c_str(), std::to_string(opt.port).c_str(), &hints, &found) != 0 || !found) {
+        std::cerr << "can not resolve " << opt.host << "\n";
+        return 1;
+    }
+    sockaddr_storage addr{};
+    socklen_t addrLen = found->ai_addrlen;
+    std::memcpy(&addr, found->ai_addr, found->ai_addrlen);
+    freeaddrinfo(found);
+
+    //connections and requests split as evenly as possible
+    std::vector<Worker> workers;
+    workers.reserve(opt.threads);
+    for (int t = 0; t < opt.threads; t++) workers.emplace_back(opt, 0x1234567ull * (t + 1));
+    for (int i = 0; i < opt.clients; i++) {
+        Client c;
+        c.remaining = opt.requests / opt.clients + (static_cast<uint64_t>(i) < opt.requests % opt.clients);
+        workers[i % opt.threads].clients.push_back(std::move(c));
+    }
+    for (auto& w : workers) {
+        w.next_key = opt.keyspace / opt.threads * (&w - workers.data());
+        if (!w.connectAll(addr, addrLen)) return 1;
+    }
+
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < workers.size(); t++) threads.emplace_back([&w = workers[t]]() { w.run(); });
+    workers[0].run();
+    for (auto& t : threads) t.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    bool failed = false;
+    std::vector<OpSamples> merged(OP_COUNT);
+    for (auto& w : workers) {
+        failed |= w.failed;
+        for (size_t i = 0; i < OP_COUNT; i++) {
+            merged[i].ns.insert(merged[i].ns.end(), w.samples[i].ns.begin(), w.samples[i].ns.end());
+            merged[i].errors += w.samples[i].errors;
+        }
+    }
+
+    std::vector<Report> reports;
+    std::vector<uint64_t> all;
+    uint64_t allErrors = 0;
+    for (size_t i = 0; i < OP_COUNT; i++) {
+        if (merged[i].ns.empty()) continue;
+        all.insert(all.end(), merged[i].ns.begin(), merged[i].ns.end());
+        allErrors += merged[i].errors;
+        reports.push_back(makeReport(opNames[i].name, merged[i].ns, merged[i].errors, seconds));
+    }
+    reports.push_back(makeReport("total", all, allErrors, seconds));
+    printReports(opt, reports, seconds);
+    return failed ? 1 : 0;
+}
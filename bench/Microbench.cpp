@@ -0,0 +1,504 @@
+// vertex-microbench -> hot paths called in process, no sockets in the way
+// Database set/get/lpush/lpop/hset/hgetall, active expiry, dump/load and the RESP request parser
+// over a grid of key counts x value sizes x thread counts; every case gets warm-up runs then
+// repetitions, reported as the median (and best) ns/op, total Mops/s and heap allocations/op
+// allocations are counted by replacing the global operator new (thread local counters, no locking)
+//
+// g++ -std=c++20 -O2 -pthread -Iinclude bench/Microbench.cpp $(ls src/*.cpp | grep -v src/Main.cpp) -o vertex-microbench
+// ./vertex-microbench --keys 1000,1000000 --value-sizes 16,1024 --threads 1,2,4 --bench get,set
+
+#include "../include/Database.h"
+#include "../include/RespParser.h"
+#include "../include/RespWriter.h"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <unistd.h>
+
+//---------- allocation counting ----------
+
+namespace {
+thread_local uint64_t allocCount = 0;
+thread_local uint64_t allocBytes = 0;
+
+void* countedAlloc(size_t size) {
+    allocCount++;
+    allocBytes += size;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* countedAlignedAlloc(size_t size, std::align_val_t align) {
+    allocCount++;
+    allocBytes += size;
+    size_t a = static_cast<size_t>(align);
+    if (void* p = std::aligned_alloc(a, (size + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+} // namespace
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { try { return countedAlloc(size); } catch (...) { return nullptr; } }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { try { return countedAlloc(size); } catch (...) { return nullptr; } }
+void* operator new(size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void* operator new[](size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+//---------- options ----------
+
+struct Options {
+    std::vector<size_t> keys = {1000, 100000};
+    std::vector<size_t> value_sizes = {16, 512};
+    std::vector<int> threads = {1, 2, 4};
+    std::vector<std::string> benches; //empty -> all
+    size_t ops = 200000; //per thread per repetition, for the per key operations
+    int warmup = 1;
+    int reps = 5;
+    std::string format = "text"; //text | csv
+};
+
+static std::string usage() {
+    return "usage: vertex-microbench [--keys N,N...] [--value-sizes N,N...] [--threads N,N...] [--ops N]\n"
+           "                         [--warmup N] [--reps N] [--bench name,name...] [--format text|csv]\n"
+           "benches: set get lpush lpop hset hgetall expire dump load parse reply\n";
+}
+
+//"1000,10000" -> numbers, each at least min
+template <typename T>
+static bool parseList(const std::string& name, const std::string& text, T min, std::vector<T>& out) {
+    out.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        std::string item = text.substr(start, end - start);
+        try {
+            size_t used = 0;
+            unsigned long long value = std::stoull(item, &used);
+            if (used != item.size() || value < static_cast<unsigned long long>(min)) throw std::invalid_argument(item);
+            out.push_back(static_cast<T>(value));
+        } catch (const std::exception&) {
+            std::cerr << "invalid value for " << name << ": " << item << "\n";
+            return false;
+        }
+        start = end + 1;
+    }
+    return !out.empty();
+}
+
+//---------- fixture ----------
+
+enum class Dataset { None, Strings, Lists, Hashes, Volatile };
+
+// state shared by the cases: key names are built once per key count, outside any timing
+// the singleton Database keeps the loaded dataset between cases that can reuse it
+struct Fixture {
+    size_t keys = 0;
+    size_t value_size = 0;
+    int threads = 1;
+    size_t ops = 0;
+    std::vector<std::string> key_names;
+    std::vector<std::string> list_names;
+    std::vector<std::string> hash_names; //16 fields each -> keys / 16 hashes
+    std::string value;
+    std::string dump_path;
+    std::vector<std::string> requests; //one pipelined buffer of SET commands per thread
+    Dataset loaded = Dataset::None;
+    size_t loaded_keys = 0;
+    size_t loaded_value = 0;
+
+    static const size_t HASH_FIELDS = 16;
+
+    void build(size_t keyCount) {
+        if (key_names.size() == keyCount) return;
+        key_names.clear();
+        list_names.clear();
+        hash_names.clear();
+        key_names.reserve(keyCount);
+        char buf[48];
+        for (size_t i = 0; i < keyCount; i++) {
+            std::snprintf(buf, sizeof(buf), "key:%012zu", i);
+            key_names.emplace_back(buf);
+        }
+        for (size_t i = 0; i < keyCount; i++) {
+            std::snprintf(buf, sizeof(buf), "list:%012zu", i);
+            list_names.emplace_back(buf);
+        }
+        for (size_t i = 0; i < std::max<size_t>(1, keyCount / HASH_FIELDS); i++) {
+            std::snprintf(buf, sizeof(buf), "hash:%012zu", i);
+            hash_names.emplace_back(buf);
+        }
+    }
+
+    static std::string field(size_t i) { return "field:" + std::to_string(i % HASH_FIELDS); }
+
+    //dataset in place with the current key count / value size, reloaded only when it differs
+    void ensure(Dataset want) {
+        if (loaded == want && loaded_keys == keys && loaded_value == value_size) return;
+        Database& db = Database::getInstance();
+        db.flushAll();
+        loaded = want;
+        loaded_keys = keys;
+        loaded_value = value_size;
+        if (want == Dataset::Strings) {
+            for (const auto& key : key_names) db.set(key, value);
+        } else if (want == Dataset::Hashes) {
+            for (const auto& key : hash_names)
+                for (size_t f = 0; f < HASH_FIELDS; f++) db.hset(key, field(f), value);
+        }
+    }
+};
+
+//xorshift64*, one per thread
+struct Rng {
+    uint64_t state;
+    explicit Rng(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+};
+
+//---------- benches ----------
+
+// prepare runs untimed before every repetition, run is timed on every thread and returns its op count
+struct Bench {
+    const char* name;
+    bool threaded; //false -> whole keyspace operations, only run with one thread
+    void (*prepare)(Fixture& fx);
+    uint64_t (*run)(Fixture& fx, int thread);
+};
+
+static uint64_t runSet(Fixture& fx, int thread) {
+    Database& db = Database::getInstance();
+    Rng rng(thread);
+    for (size_t i = 0; i < fx.ops; i++) db.set(fx.key_names[rng.next() % fx.keys], fx.value);
+    return fx.ops;
+}
+
+static uint64_t runGet(Fixture& fx, int thread) {
+    Database& db = Database::getInstance();
+    Rng rng(thread);
+    StringRef ref;
+    uint64_t hits = 0;
+    for (size_t i = 0; i < fx.ops; i++) hits += db.get(fx.key_names[rng.next() % fx.keys], ref);
+    return hits == fx.ops ? fx.ops : 0; //a miss means the dataset is wrong, shows up as 0 ops
+}
+
+static uint64_t runLpush(Fixture& fx, int thread) {
+    Database& db = Database::getInstance();
+    Rng rng(thread);
+    for (size_t i = 0; i < fx.ops; i++) db.lpush(fx.list_names[rng.next() % fx.keys], fx.value);
+    return fx.ops;
+}
+
+//lists start empty every repetition -> they do not grow across repetitions
+static void prepareLpush(Fixture& fx) {
+    fx.loaded = Dataset::None;
+    fx.ensure(Dataset::Lists);
+}
+
+//every pop of the timed run has exactly one element pushed for it here
+static void prepareLpop(Fixture& fx) {
+    fx.ensure(Dataset::Lists);
+    Database& db = Database::getInstance();
+    for (int t = 0; t < fx.threads; t++)
+        for (size_t i = 0; i < fx.ops; i++) db.lpush(fx.list_names[(t * fx.ops + i) % fx.keys], fx.value);
+}
+
+static uint64_t runLpop(Fixture& fx, int thread) {
+    Database& db = Database::getInstance();
+    std::string out;
+    for (size_t i = 0; i < fx.ops; i++) db.lpop(fx.list_names[(thread * fx.ops + i) % fx.keys], out);
+    return fx.ops;
+}
+
+static uint64_t runHset(Fixture& fx, int thread) {
+    Database& db = Database::getInstance();
+    Rng rng(thread);
+    std::vector<std::string> fields;
+    for (size_t f = 0; f < Fixture::HASH_FIELDS; f++) fields.push_back(Fixture::field(f));
+    for (size_t i = 0; i < fx.ops; i++) {
+        uint64_t r = rng.next();
+        db.hset(fx.hash_names[r % fx.hash_names.size()], fields[(r >> 32) % Fixture::HASH_FIELDS], fx.value);
+    }
+    return fx.ops;
+}
+
+static uint64_t runHgetall(Fixture& fx, int thread) {
+    Database& db = Database::getInstance();
+    Rng rng(thread);
+    size_t bytes = 0;
+    for (size_t i = 0; i < fx.ops; i++) {
+        db.hgetall(fx.hash_names[rng.next() % fx.hash_names.size()], [](size_t) {},
+                   [&bytes](std::string_view f, std::string_view v) { bytes += f.size() + v.size(); });
+    }
+    return bytes ? fx.ops : 0;
+}
+
+//every key due 1ms from now, expired by the time the run starts
+static void prepareExpire(Fixture& fx) {
+    Database& db = Database::getInstance();
+    db.flushAll();
+    fx.loaded = Dataset::Volatile;
+    int64_t when = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() + 1;
+    for (const auto& key : fx.key_names) {
+        db.set(key, fx.value);
+        db.pexpireAt(key, when);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+}
+
+//budget far above what the keyspace needs -> the cycle ends when every shard is idle
+static uint64_t runExpire(Fixture&, int) {
+    return Database::getInstance().activeExpireCycle(int64_t(3600) * 1000000);
+}
+
+static void prepareDump(Fixture& fx) {
+    fx.ensure(Dataset::Strings);
+}
+
+static uint64_t runDump(Fixture& fx, int) {
+    return Database::getInstance().dump(fx.dump_path) ? fx.keys : 0;
+}
+
+//the dump file is written once per dataset, load replaces the keyspace with the same keys
+static void prepareLoad(Fixture& fx) {
+    if (fx.loaded != Dataset::Strings || fx.loaded_keys != fx.keys || fx.loaded_value != fx.value_size) {
+        fx.ensure(Dataset::Strings);
+        Database::getInstance().dump(fx.dump_path);
+    }
+}
+
+static uint64_t runLoad(Fixture& fx, int) {
+    return Database::getInstance().load(fx.dump_path) ? fx.keys : 0;
+}
+
+//ops pipelined SET commands per thread, parsed like a reactor does (views into the buffer)
+static void prepareParse(Fixture& fx) {
+    if (fx.requests.size() == static_cast<size_t>(fx.threads)) return;
+    fx.requests.assign(fx.threads, std::string());
+    for (auto& buf : fx.requests) {
+        for (size_t i = 0; i < fx.ops; i++) {
+            const std::string& key = fx.key_names[i % fx.keys];
+            buf += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n$" +
+                   std::to_string(fx.value.size()) + "\r\n" + fx.value + "\r\n";
+        }
+    }
+}
+
+static uint64_t runParse(Fixture& fx, int thread) {
+    const std::string& buf = fx.requests[thread];
+    RespParser parser;
+    std::vector<std::string_view> args;
+    uint64_t parsed = 0;
+    while (parser.parse(buf, args) == ParseStatus::Complete) parsed++;
+    return parsed;
+}
+
+//GET style bulk replies into one connection's OutputBuffer, "sent" with gather + consume every 16
+//like a reactor flushing a pipeline -> after the first chunk the buffer should recycle it, 0 allocs/op
+static uint64_t runReply(Fixture& fx, int) {
+    static const size_t PIPELINE = 16;
+    OutputBuffer buffer;
+    RespWriter out(buffer);
+    iovec iov[64];
+    for (size_t i = 0; i < fx.ops; i++) {
+        out.bulk(std::string_view(fx.value));
+        if ((i + 1) % PIPELINE == 0) {
+            size_t sent = 0;
+            int n = buffer.gather(iov, 64);
+            for (int v = 0; v < n; v++) sent += iov[v].iov_len;
+            buffer.consume(sent);
+        }
+    }
+    return buffer.size() <= PIPELINE * (fx.value.size() + 16) ? fx.ops : 0;
+}
+
+static const Bench benches[] = {
+    {"set",     true,  [](Fixture& fx) { fx.ensure(Dataset::Strings); }, runSet},
+    {"get",     true,  [](Fixture& fx) { fx.ensure(Dataset::Strings); }, runGet},
+    {"lpush",   true,  prepareLpush, runLpush},
+    {"lpop",    true,  prepareLpop, runLpop},
+    {"hset",    true,  [](Fixture& fx) { fx.ensure(Dataset::Hashes); }, runHset},
+    {"hgetall", true,  [](Fixture& fx) { fx.ensure(Dataset::Hashes); }, runHgetall},
+    {"expire",  false, prepareExpire, runExpire},
+    {"dump",    false, prepareDump, runDump},
+    {"load",    false, prepareLoad, runLoad},
+    {"parse",   true,  prepareParse, runParse},
+    {"reply",   true,  [](Fixture&) {}, runReply},
+};
+
+//---------- runner ----------
+
+struct Sample {
+    double wall_ns;
+    uint64_t ops;
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+};
+
+//all threads released together, wall time from the release to the last one done
+static Sample runOnce(const Bench& bench, Fixture& fx) {
+    bench.prepare(fx);
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> ops{0}, allocs{0}, bytes{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < fx.threads; t++) {
+        workers.emplace_back([&, t]() {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            uint64_t a0 = allocCount, b0 = allocBytes;
+            ops.fetch_add(bench.run(fx, t));
+            allocs.fetch_add(allocCount - a0);
+            bytes.fetch_add(allocBytes - b0);
+        });
+    }
+    while (ready.load() < fx.threads) std::this_thread::yield();
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers) w.join();
+    double wall = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return {wall, ops.load(), allocs.load(), bytes.load()};
+}
+
+struct Result {
+    std::string name;
+    size_t keys, value_size;
+    int threads;
+    uint64_t ops;      //per repetition, all threads
+    double ns_per_op;  //median repetition, wall time / ops done by one thread
+    double best_ns_per_op;
+    double mops;       //all threads together, median repetition
+    double allocs_per_op;
+    double bytes_per_op;
+};
+
+static Result measure(const Bench& bench, Fixture& fx, const Options& opt) {
+    for (int i = 0; i < opt.warmup; i++) runOnce(bench, fx);
+    std::vector<Sample> samples;
+    for (int i = 0; i < opt.reps; i++) samples.push_back(runOnce(bench, fx));
+    std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) {
+        return a.wall_ns / std::max<uint64_t>(a.ops, 1) < b.wall_ns / std::max<uint64_t>(b.ops, 1);
+    });
+    const Sample& median = samples[samples.size() / 2];
+    const Sample& best = samples.front();
+    double perThread = static_cast<double>(std::max<uint64_t>(median.ops, 1)) / fx.threads;
+    Result r{bench.name, fx.keys, fx.value_size, fx.threads, median.ops, 0, 0, 0, 0, 0};
+    r.ns_per_op = median.wall_ns / perThread;
+    r.best_ns_per_op = best.wall_ns / (static_cast<double>(std::max<uint64_t>(best.ops, 1)) / fx.threads);
+    r.mops = static_cast<double>(median.ops) / median.wall_ns * 1000.0;
+    r.allocs_per_op = static_cast<double>(median.allocs) / std::max<uint64_t>(median.ops, 1);
+    r.bytes_per_op = static_cast<double>(median.alloc_bytes) / std::max<uint64_t>(median.ops, 1);
+    return r;
+}
+
+static void printResult(const Result& r, const Options& opt) {
+    if (opt.format == "csv") {
+        std::printf("%s,%zu,%zu,%d,%llu,%.1f,%.1f,%.3f,%.2f,%.1f\n", r.name.c_str(), r.keys, r.value_size, r.threads,
+                    static_cast<unsigned long long>(r.ops), r.ns_per_op, r.best_ns_per_op, r.mops, r.allocs_per_op, r.bytes_per_op);
+    } else {
+        std::printf("%-8s %10zu %6zu %4d %12llu %10.1f %10.1f %9.3f %9.2f %10.1f\n", r.name.c_str(), r.keys, r.value_size,
+                    r.threads, static_cast<unsigned long long>(r.ops), r.ns_per_op, r.best_ns_per_op, r.mops,
+                    r.allocs_per_op, r.bytes_per_op);
+    }
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = i + 1 < argc && arg != "--help";
+        if (!ok) {
+            std::cerr << usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--keys") ok = parseList(arg, value, size_t(1), opt.keys);
+        else if (arg == "--value-sizes") ok = parseList(arg, value, size_t(0), opt.value_sizes);
+        else if (arg == "--threads") ok = parseList(arg, value, 1, opt.threads);
+        else if (arg == "--ops") {
+            std::vector<size_t> one;
+            ok = parseList(arg, value, size_t(1), one) && one.size() == 1;
+            if (ok) opt.ops = one[0];
+        } else if (arg == "--warmup" || arg == "--reps") {
+            std::vector<int> one;
+            ok = parseList(arg, value, arg == "--reps" ? 1 : 0, one) && one.size() == 1;
+            if (ok) (arg == "--reps" ? opt.reps : opt.warmup) = one[0];
+        } else if (arg == "--bench") {
+            for (size_t start = 0; start <= value.size();) {
+                size_t end = std::min(value.find(',', start), value.size());
+                std::string name = value.substr(start, end - start);
+                ok &= std::any_of(std::begin(benches), std::end(benches), [&](const Bench& b) { return name == b.name; });
+                if (!ok) std::cerr << "unknown bench: " << name << "\n";
+                opt.benches.push_back(name);
+                start = end + 1;
+            }
+        } else if (arg == "--format") {
+            ok = value == "text" || value == "csv";
+            opt.format = value;
+        } else {
+            std::cerr << "unknown option: " << arg << "\n";
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << usage();
+            return 1;
+        }
+    }
+
+    //load logs its phases to std::cout, results go out through printf
+    std::cout.setstate(std::ios::failbit);
+
+    Fixture fx;
+    fx.dump_path = "/tmp/vertex-microbench-" + std::to_string(getpid()) + ".rdb";
+
+    if (opt.format == "csv") std::printf("bench,keys,value_size,threads,ops,ns_per_op,best_ns_per_op,mops,allocs_per_op,bytes_per_op\n");
+    else std::printf("%-8s %10s %6s %4s %12s %10s %10s %9s %9s %10s\n", "bench", "keys", "value", "thr", "ops/rep",
+                     "ns/op", "best", "Mops/s", "allocs/op", "bytes/op");
+
+    for (size_t keys : opt.keys) {
+        fx.build(keys);
+        fx.keys = keys;
+        for (size_t valueSize : opt.value_sizes) {
+            fx.value_size = valueSize;
+            fx.value.assign(valueSize, 'v');
+            fx.requests.clear();
+            for (const auto& bench : benches) {
+                if (!opt.benches.empty() && std::find(opt.benches.begin(), opt.benches.end(), bench.name) == opt.benches.end())
+                    continue;
+                for (int threads : opt.threads) {
+                    if (!bench.threaded && threads != 1) continue;
+                    fx.threads = threads;
+                    fx.ops = opt.ops;
+                    printResult(measure(bench, fx, opt), opt);
+                }
+            }
+        }
+    }
+    unlink(fx.dump_path.c_str());
+    return 0;
+}
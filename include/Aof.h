@@ -0,0 +1,104 @@
+#ifndef AOF_H
+#define AOF_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+
+class CommandHandler;
+struct CommandSpec;
+
+//when appended commands reach the disk
+enum class FsyncPolicy {
+    Always,   //reply only after fsync, one fsync per batch (group commit)
+    EverySec, //written every ms, fsync at most once a second -> lose <= 1s
+    No        //written every ms, the kernel decides
+};
+
+bool parseFsyncPolicy(std::string_view text, FsyncPolicy& out);
+const char* fsyncPolicyName(FsyncPolicy policy);
+
+// append only file -> every successful write command as RESP, replayed at startup
+// reactors only append to an in memory buffer, one flusher thread turns the buffer
+// into a single write (+ fsync) per millisecond or as soon as an Always client waits
+// BGREWRITEAOF forks a child that writes the keyspace as commands, new writes are kept
+// in a side buffer meanwhile and appended before the rewritten file replaces the old one
+class AppendOnlyFile {
+public:
+    AppendOnlyFile(std::string filename, FsyncPolicy policy, size_t shardCount);
+    ~AppendOnlyFile();
+
+    //opens for append (writes the current keyspace first when the file is new) and starts the flusher
+    bool open();
+    void close(); //flush + fsync whatever is buffered, stop the flusher
+
+    //streams the log through the handler, a torn last command is cut off
+    static bool replay(const std::string& filename, CommandHandler& handler, uint64_t& commands);
+
+    //nullptr when appendonly is off
+    static AppendOnlyFile* active() { return activeAof; }
+
+    //held around execute + feed so two writes to one key hit the log in execution order
+    std::vector<std::unique_lock<std::mutex>> lockKeys(const CommandSpec& spec, const std::vector<std::string_view>& args);
+    void feed(const std::vector<std::string_view>& args); //as it should replay, EXPIRE already made absolute
+
+    //Always policy -> true when this thread appended something not fsynced yet
+    bool needsSync() const;
+    //blocks until everything this thread appended is fsynced, false -> a write or fsync failed first
+    //(those appends are then forgotten by this thread, their clients must not get a success reply)
+    bool waitDurable();
+
+    //last write or fsync failed -> write commands are refused (MISCONF) until one works again
+    bool writeFailed() const { return write_error.load(std::memory_order_relaxed); }
+
+    bool rewriteInBackground(); //false when a rewrite is already running
+    std::string info() const;
+
+private:
+    static AppendOnlyFile* activeAof;
+
+    std::string filename;
+    FsyncPolicy policy;
+    int fd = -1;
+
+    //one ordering lock per keyspace shard, taken in ascending order like the shard locks
+    std::vector<std::mutex> order_locks;
+
+    mutable std::mutex mutex;          //guards everything below
+    std::condition_variable wake;      //flusher: data or a sync waiter
+    std::condition_variable durable;   //sync waiters: fsync done
+    std::string buf;                   //appended, not written yet
+    uint64_t appended = 0;             //bytes ever appended
+    uint64_t synced = 0;               //bytes known to be fsynced
+    int sync_waiters = 0;
+    bool running = false;
+    std::atomic<bool> write_error{false}; //set + cleared by the flusher under the mutex
+    int write_errno = 0;
+    std::thread flusher;
+
+    //background rewrite
+    bool rewriting = false;
+    pid_t rewrite_child = -1;
+    std::string rewrite_buf;          //writes since the fork, go after the child's output
+    int rewrite_status = -1;          //child exit status once reaped, -1 -> still running
+
+    //stats
+    std::atomic<uint64_t> file_size{0};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> fsyncs{0};
+    std::atomic<uint64_t> rewrites{0};
+    std::atomic<bool> last_rewrite_ok{true};
+    std::atomic<uint64_t> max_batch{0};
+
+    void flushLoop();
+    bool finishRewrite(std::unique_lock<std::mutex>& lock); //flusher thread, mutex held
+    std::string rewriteTempName() const;
+};
+
+#endif
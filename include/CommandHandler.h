@@ -2,12 +2,50 @@
 #define COMMAND_HANDLER_H
 
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class Database;
+
+//command flags, reported by COMMAND
+enum CommandFlags : uint32_t {
+    CMD_READONLY = 1 << 0, //never modifies the keyspace
+    CMD_WRITE    = 1 << 1, //may modify the keyspace
+    CMD_MULTIKEY = 1 << 2, //touches more than one key
+    CMD_ADMIN    = 1 << 3, //server introspection / management
+    CMD_FAST     = 1 << 4, //O(1) or O(log n)
+    CMD_DENYOOM  = 1 << 5  //may grow memory -> evicts first, refused when over maxmemory and nothing can go
+};
+
+class RespWriter;
+
+//handlers write their reply straight into the connection's output buffer
+using CommandFn = void (*)(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out);
+
+struct CommandSpec {
+    std::string_view name; //lower case
+    int arity;             //>0 exact token count, <0 at least -arity (command name included)
+    uint32_t flags;
+    int first_key;
+    int last_key;          //-1 -> last argument
+    int key_step;
+    CommandFn handler;
+};
+
+//O(1) case insensitive lookup in the compile time command table, nullptr if unknown
+const CommandSpec* lookupCommand(std::string_view name);
+size_t commandCount();
+const CommandSpec& commandAt(size_t index); //table order -> index of the per command stats
 
 class CommandHandler{
     public:
         CommandHandler();
 
-        std::string processCommand(const std::string& commandLine);
+        //already tokenized command from the connection parser, views into its receive buffer
+        //reply (or error) appended to out, client (ip:port) only shows up in SLOWLOG
+        void processCommand(const std::vector<std::string_view>& tokens, RespWriter& out, std::string_view client = {});
     
 };
 
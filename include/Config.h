@@ -0,0 +1,44 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <cstddef>
+
+// startup options
+// ./vertex [port] [--port N] [--reactors N] [--shards N]
+//          [--list-max-listpack-entries N] [--list-max-listpack-value N]
+//          [--hash-max-listpack-entries N] [--hash-max-listpack-value N]
+//          [--appendonly yes|no] [--appendfsync always|everysec|no]
+//          [--maxmemory bytes[kb|mb|gb]] [--maxmemory-policy P] [--maxmemory-samples N]
+//          [--slowlog-log-slower-than usec] [--slowlog-max-len N]
+//          [--client-query-buffer-limit bytes] [--client-output-buffer-limit bytes]
+struct Config {
+    int port = 6440;
+    int reactors = 1; //epoll reactor threads, each with its own SO_REUSEPORT listener
+    int shards = 16;  //keyspace shards (power of two), one reader/writer lock each
+    //compact encoding limits, 0 entries -> always use the full structure
+    int list_max_listpack_entries = 128;
+    int list_max_listpack_value = 64;
+    int hash_max_listpack_entries = 128;
+    int hash_max_listpack_value = 64;
+    //append only file (appendonly.aof), replayed instead of the snapshot when on
+    bool appendonly = false;
+    std::string appendfsync = "everysec";
+    //memory limit, 0 -> none, the policy picks what goes once it is reached
+    size_t maxmemory = 0;
+    std::string maxmemory_policy = "noeviction";
+    int maxmemory_samples = 5;
+    //SLOWLOG -> commands taking at least this long (usec, -1 off, 0 all), newest max_len kept
+    int slowlog_log_slower_than = 10000;
+    int slowlog_max_len = 128;
+    //a client past either buffer is disconnected, output 0 -> no limit
+    size_t client_query_buffer_limit = size_t(1024) * 1024 * 1024;
+    size_t client_output_buffer_limit = 512 * 1024 * 1024;
+};
+
+//fills config from argv, on bad input prints the reason and returns false
+bool parseArgs(int argc, char* argv[], Config& config);
+
+std::string usage();
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef CRC64_H
+#define CRC64_H
+
+#include <cstdint>
+#include <cstddef>
+
+// crc64 jones (reflected, poly 0xad93d23594c935a9) -> same checksum redis puts in its rdb files
+// slice by 8 table walk, ~1.5GB/s so it never shows up next to disk I/O
+// chain calls by passing the previous result as crc
+uint64_t crc64(uint64_t crc, const void* data, size_t len);
+
+#endif
@@ -2,67 +2,327 @@
 #define DATABASE_H
 
 #include <string>
+#include <string_view>
 #include <mutex>
+#include <shared_mutex>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <chrono>
+#include <stdexcept>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <sys/types.h>
+#include "Value.h"
 
+//operation against a key holding another type -> handlers reply WRONGTYPE
+class WrongTypeError : public std::runtime_error {
+public:
+    WrongTypeError() : std::runtime_error("WRONGTYPE Operation against a key holding the wrong kind of value") {}
+};
+
+//what goes when used memory passes maxmemory (Eviction.cpp)
+enum class EvictionPolicy {
+    NoEviction, //writes that could grow memory get an OOM error, deletes still work
+    AllKeysLru, //least recently used among all keys
+    AllKeysLfu, //least frequently used (decaying log counter) among all keys
+    VolatileLru, //least recently used among keys with a ttl
+    VolatileTtl  //nearest expiry first
+};
+
+bool parseEvictionPolicy(std::string_view text, EvictionPolicy& out);
+const char* evictionPolicyName(EvictionPolicy policy);
+
+//fsync of the directory holding path (Snapshot.cpp) -> a file renamed into it survives a crash
+bool syncParentDir(const std::string& path);
+
+// shard reader/writer lock that reports contention (INFO stats -> shard_lock_waits)
+// try first, only an acquire that has to block reads the clock -> uncontended it costs a plain shared_mutex
+class ShardMutex {
+public:
+    void lock() { if (!mutex.try_lock()) lockSlow(); }
+    bool try_lock() { return mutex.try_lock(); }
+    void unlock() { mutex.unlock(); }
+    void lock_shared() { if (!mutex.try_lock_shared()) lockSharedSlow(); }
+    bool try_lock_shared() { return mutex.try_lock_shared(); }
+    void unlock_shared() { mutex.unlock_shared(); }
+
+private:
+    std::shared_mutex mutex;
+    void lockSlow();
+    void lockSharedSlow();
+};
+
+// keys/values arrive as string_views into the client's receive buffer
+// they are only copied when the database actually stores them
+// keyspace is split in power of two shards picked by key hash, each with its own reader/writer lock
+// every shard has one dictionary key -> Value, so any key operation is a single lookup
 class Database {
 public: 
+    static const size_t DEFAULT_SHARDS = 16;
+
     // get instance {singleton}
     static Database& getInstance();
 
+    //startup only, count must be a power of two
+    bool configureShards(size_t count);
+    size_t shardCount() const { return shards.size(); }
+    size_t shardOf(std::string_view key) const { return shardIndex(key); }
+
     // general commands
-    bool flushAll();
+    // async -> every shard's dictionary is swapped for an empty one, LazyFree frees the old ones
+    bool flushAll(bool async = false);
 
     // key value ops
-    void set(const std::string& key, const std::string& value);
-    bool get(const std::string& key, std::string& value);
-    std::vector<std::string> keys();
-    std::string type(const std::string& key);
-    bool del(const std::string& key);
-    bool expire(const std::string& key, int seconds);
-    void purgeExpired();
-    bool rename(const std::string& oldKey, const std::string& newKey);
+    void set(std::string_view key, std::string_view value);
+    // big values come back as a reference to the stored buffer, serialized after the lock is gone
+    bool get(std::string_view key, StringRef& value);
+    // batched -> every shard involved is locked once, all together (atomic like redis)
+    // mget: nullopt for missing keys and keys of another type
+    std::vector<std::optional<StringRef>> mget(const std::vector<std::string_view>& keys);
+    void mset(const std::vector<std::pair<std::string_view, std::string_view>>& pairs);
+    bool msetnx(const std::vector<std::pair<std::string_view, std::string_view>>& pairs); //false -> nothing set
+    // keys matching a glob, filtered shard by shard under that shard's lock (no full copy first)
+    // a pattern without wildcards is a single lookup
+    std::vector<std::string> keys(std::string_view pattern);
+    // SCAN: cursor = (bucket cursor << shard bits) | shard, see Dict::scan for why it survives rehashing
+    // one call visits ~count entries (at most count * 10 buckets), one shard lock held at a time
+    // matches go to out, returns the next cursor, 0 -> done
+    uint64_t scan(uint64_t cursor, size_t count, std::string_view pattern,
+                  std::optional<ValueType> type, std::vector<std::string>& out);
+    std::string type(std::string_view key);
+    std::string encoding(std::string_view key); //empty when missing
+    bool del(std::string_view key);
+    // UNLINK: the value leaves the keyspace in O(1), a big one is freed by LazyFree after unlocking
+    bool unlink(std::string_view key);
+    int64_t expire(std::string_view key, int seconds); //deadline stored (absolute unix ms), 0 -> no such key
+    bool pexpireAt(std::string_view key, int64_t whenMs); //absolute unix ms
+    int64_t pttl(std::string_view key); //-2 missing, -1 no expiry, else ms left
+    bool persist(std::string_view key);
+    bool rename(std::string_view oldKey, std::string_view newKey);
 
     // list ops
-    std::vector<std::string> lget(const std::string& key);
-    ssize_t llen(const std::string& key);
-    void lpush(const std::string& key, const std::string& value);
-    void rpush(const std::string& key, const std::string& value);
-    bool lpop(const std::string& key, std::string& value);
-    bool rpop(const std::string& key, std::string& value);
-    int lrem(const std::string& key, int count, const std::string& value);
-    bool lindex(const std::string& key, int index, std::string& value);
-    bool lset(const std::string& key, int index, const std::string& value);
+    // LRANGE: header(n) once, then item(view) for each element of the slice, read straight out of
+    // the list under its shard lock -> only the slice is touched and nothing is copied on the way
+    // start/stop inclusive, negative counts from the tail, clamped like redis
+    template <typename Header, typename Item>
+    void lrange(std::string_view key, long start, long stop, Header&& header, Item&& item);
+    bool ltrim(std::string_view key, long start, long stop); //empty slice -> key removed
+    long linsert(std::string_view key, bool after, std::string_view pivot, std::string_view value); //-1 no pivot, 0 no key, else new length
+    // LPOS: indexes of matches, rank 1 -> first match (negative -> from the tail), count 0 -> all,
+    // maxlen 0 -> compare the whole list
+    std::vector<long> lpos(std::string_view key, std::string_view item, long rank, size_t count, size_t maxlen);
+    ssize_t llen(std::string_view key);
+    void lpush(std::string_view key, std::string_view value);
+    void rpush(std::string_view key, std::string_view value);
+    bool lpop(std::string_view key, std::string& value);
+    bool rpop(std::string_view key, std::string& value);
+    int lrem(std::string_view key, int count, std::string_view value);
+    bool lindex(std::string_view key, int index, std::string& value);
+    bool lset(std::string_view key, int index, std::string_view value);
 
     // hash ops
-    bool hset(const std::string& key, const std::string& field, const std::string& value);
-    bool hget(const std::string& key, const std::string& field, std::string& value);
-    bool hexists(const std::string& key, const std::string& field);
-    bool hdel(const std::string& key, const std::string& field);
-    std::unordered_map<std::string, std::string> hgetall(const std::string& key);
-    std::vector<std::string> hkeys(const std::string& key);
-    std::vector<std::string> hvals(const std::string& key);
-    ssize_t hlen(const std::string& key);
-    bool hmset(const std::string& key, const std::vector<std::pair<std::string, std::string>>& fieldValues);
-
-    // dump/load to/from a file
+    bool hset(std::string_view key, std::string_view field, std::string_view value);
+    bool hget(std::string_view key, std::string_view field, std::string& value);
+    bool hexists(std::string_view key, std::string_view field);
+    bool hdel(std::string_view key, std::string_view field);
+    // HGETALL/HKEYS/HVALS: header(pairs) once, then pair(field, value) for each, under the shard lock
+    template <typename Header, typename Pair>
+    void hgetall(std::string_view key, Header&& header, Pair&& pair);
+    ssize_t hlen(std::string_view key);
+    bool hmset(std::string_view key, const std::vector<std::pair<std::string_view, std::string_view>>& fieldValues);
+    // HSCAN: same cursor rules as scan, a listpack hash is returned whole with cursor 0
+    uint64_t hscan(std::string_view key, uint64_t cursor, size_t count, std::string_view pattern,
+                   std::vector<std::pair<std::string, std::string>>& out);
+
+    // memory limit (Eviction.cpp)
+    // used memory = estimate per key (dict entry + key + Value::memoryUsage) + buckets + expiry heaps,
+    // kept per shard by every write -> reading it is one relaxed load per shard
+    // set after loading -> a dataset bigger than the limit still loads whole, eviction starts with the first write
+    void configureMemory(size_t maxBytes, EvictionPolicy policy, size_t samples);
+    size_t usedMemory() const;
+    bool overMaxmemory() const { return eviction.maxmemory && usedMemory() > eviction.maxmemory; }
+    // eviction is two calls so the caller can take the append only file ordering lock of the
+    // victim in between (an evicted key is logged as a DEL)
+    // candidate: best key of a pool fed by sampling a few shards, false -> nothing evictable left
+    bool evictionCandidate(std::string& key);
+    bool evictKey(std::string_view key); //false -> gone (or lost its ttl) meanwhile
+    long long memoryUsage(std::string_view key); //MEMORY USAGE, -1 missing
+    std::string memoryInfo() const;
+
+    // active expiry -> called periodically by the expirer thread
+    // walks the per shard expiry heaps round robin until budgetUs is spent, returns keys removed
+    size_t activeExpireCycle(int64_t budgetUs);
+    std::string expiryInfo() const;
+
+    // dump/load to/from a file (Snapshot.cpp)
+    // binary snapshot, see the format notes there; load still reads the old text dumps
+    // dump blocks writers for the whole save -> shutdown / SAVE only
     bool dump(const std::string& filename);
     bool load(const std::string& filename);
+    // point in time snapshot from a fork()ed child, writers only wait for the fork itself
+    // returns at once, false when a save is already running
+    bool bgsave(const std::string& filename);
+    std::string persistenceInfo() const;
+
+    // keyspace as write commands (SET / RPUSH / HMSET / PEXPIREAT) -> base of the append only file
+    bool writeCommandLog(const std::string& path);
+    // same from a fork()ed child, returns its pid (-1 on failure), caller reaps it
+    pid_t forkCommandLog(const std::string& path);
 
 private:
-    Database() = default;
+    Database();
     ~Database() = default;
     Database(const Database&) = delete;
     Database& operator=(const Database&) = delete;
 
-    std::mutex db_mutex;
-    std::unordered_map<std::string, std::string> kv_store;
-    std::unordered_map<std::string, std::vector<std::string>> list_store;
-    std::unordered_map<std::string, std::unordered_map<std::string, std::string>> hash_store;
+    //min heap entry, may be stale (key deleted / ttl changed) -> validated against the Value on pop
+    struct ExpireEntry {
+        int64_t when;
+        std::string key;
+        bool operator>(const ExpireEntry& other) const { return when > other.when; }
+    };
 
-    std::unordered_map<std::string, std::chrono::steady_clock::time_point> expiry_map;
+    struct Shard {
+        ShardMutex mutex; //shared for reads, exclusive for writes
+        Dict<Value> dict; //power of two buckets -> SCAN cursors survive rehashing
+        std::vector<ExpireEntry> expires; //min heap on when
+        size_t volatile_keys = 0; //keys with a ttl, sizes the stale part of the heap
+        //bytes of everything above, written under the exclusive lock, read lock free
+        std::atomic<size_t> used_memory{0};
+    };
+
+    //eviction candidate, higher score goes first
+    struct EvictionCandidate {
+        uint64_t score;
+        std::string key;
+    };
+
+    struct EvictionState {
+        size_t maxmemory = 0; //0 -> no limit
+        EvictionPolicy policy = EvictionPolicy::NoEviction;
+        size_t samples = 5; //keys sampled per shard visit, like maxmemory-samples
+        std::mutex mutex; //guards pool + cursor
+        std::vector<EvictionCandidate> pool; //ascending score, survives between evictions
+        size_t cursor = 0; //next shard to sample
+        std::atomic<uint64_t> evicted_keys{0};
+        std::atomic<uint64_t> evicted_bytes{0};
+    };
+
+    //expiry counters, relaxed atomics -> INFO reads them from any thread
+    struct ExpiryStats {
+        std::atomic<uint64_t> expired_keys{0};        //lazy + active
+        std::atomic<uint64_t> active_expired_keys{0};
+        std::atomic<uint64_t> cycles{0};
+        std::atomic<uint64_t> last_cycle_us{0};
+        std::atomic<uint64_t> max_cycle_us{0};
+        std::atomic<uint64_t> expired_per_sec{0};     //rate over the last full second
+        uint64_t window_start_ms = 0; //expirer thread only
+        uint64_t window_base = 0;
+    };
+
+    //snapshot counters, written by the saving thread, read by INFO
+    struct SaveStats {
+        std::atomic<bool> in_progress{false}; //one background save at a time
+        std::atomic<uint64_t> saves{0};
+        std::atomic<uint64_t> failed_saves{0};
+        std::atomic<bool> last_ok{true};
+        std::atomic<int64_t> last_save_ms{0};      //unix ms of the last successful save
+        std::atomic<uint64_t> last_duration_us{0}; //start to rename
+        std::atomic<uint64_t> last_bytes{0};
+        std::atomic<uint64_t> last_stall_us{0};    //how long writers were blocked
+        std::atomic<uint64_t> max_stall_us{0};
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    unsigned shard_bits = 0; //log2(shards.size())
+    size_t expire_cursor = 0; //next shard for the active expirer (expirer thread only)
+    ExpiryStats expiry_stats;
+    SaveStats save_stats;
+    EvictionState eviction;
+
+    size_t shardIndex(std::string_view key) const;
+    Shard& shardFor(std::string_view key);
+
+    //every shard in ascending index order (the lock ordering rule)
+    std::vector<std::unique_lock<ShardMutex>> lockAllExclusive();
+    std::vector<std::shared_lock<ShardMutex>> lockAllShared();
+    //distinct shards of a key batch, ascending -> same ordering rule as above
+    template <typename Keys, typename KeyOf>
+    std::vector<size_t> shardsOf(const Keys& keys, KeyOf keyOf) const;
+    std::vector<std::unique_lock<ShardMutex>> lockShardsExclusive(const std::vector<size_t>& idx);
+    std::vector<std::shared_lock<ShardMutex>> lockShardsShared(const std::vector<size_t>& idx);
+
+    //exclusive lock held, returns the big buffer it replaced so the caller frees it after unlocking
+    std::optional<Value> setLocked(Shard& shard, std::string_view key, std::string_view value, SharedString big);
+    //redis range rules -> first index + item count, false when the slice is empty
+    static bool sliceOf(long start, long stop, size_t len, size_t& from, size_t& n);
+
+    //serializes every shard into path + fsync, caller keeps writers out (locks or a fork child)
+    bool writeSnapshot(const std::string& path, uint64_t& bytes);
+    bool writeCommands(const std::string& path); //no locking, same rule as writeSnapshot
+    //forks with every shard locked exclusively -> the child sees no half done write
+    //child runs work() and exits with 0 on true
+    pid_t forkChild(const std::function<bool()>& work);
+    void runBgsave(const std::string& filename);
+    void recordSave(bool ok, uint64_t durationUs, uint64_t bytes, uint64_t stallUs);
+
+    //load helpers, all shards exclusively locked and empty
+    bool loadBinary(const char* data, size_t size);
+    bool loadText(const std::string& filename);
+
+    void scheduleExpire(Shard& shard, std::string_view key, int64_t when);
+    bool compactExpires(Shard& shard); //drops stale heap entries once they dominate
+    size_t expireShard(Shard& shard, int64_t now, size_t limit);
+    bool rehashShard(Shard& shard); //one incremental step, true -> still rehashing
+
+    //memory accounting, exclusive lock held (Eviction.cpp)
+    static size_t entryMemory(std::string_view key, const Value& value);
+    static size_t expireEntryMemory(std::string_view key);
+    static void charge(Shard& shard, size_t add, size_t sub);
+    //every insert / erase of the keyspace goes through these two -> the shard total stays exact
+    Value& insertEntry(Shard& shard, std::string_view key, Value&& value);
+    //runs fn(value) and charges the shard whatever the value grew or shrank by (ttl gained / lost too),
+    //returns fn's result
+    template <typename F>
+    auto mutate(Shard& shard, Value& value, F&& fn);
+    //returns the erased value, moved out -> the caller picks when (and where) it is freed
+    Value eraseEntry(Shard& shard, Dict<Value>::iterator it);
+    void recountMemory(Shard& shard); //after a load
+    //eviction clock of a value: set on insert, refreshed on access (no-op for policies not using it)
+    void initClock(Value& value) const;
+    void touch(const Value& value) const;
+    void sampleForEviction(Shard& shard); //eviction.mutex + no shard lock held
+
+    //shared lock held -> expired keys look missing, nothing is mutated
+    const Value* lookupRead(Shard& shard, std::string_view key, ValueType type);
+    //exclusive lock held -> expired key is removed right here
+    Value* lookupWrite(Shard& shard, std::string_view key);
+    Value* lookupWrite(Shard& shard, std::string_view key, ValueType type);
+    //existing value of that type or a fresh empty one
+    Value& lookupOrCreate(Shard& shard, std::string_view key, ValueType type);
 };
 
+template <typename Header, typename Item>
+void Database::lrange(std::string_view key, long start, long stop, Header&& header, Item&& item) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    const Value* value = lookupRead(shard, key, ValueType::List);
+    size_t from = 0, n = 0;
+    if (value) sliceOf(start, stop, value->listSize(), from, n);
+    header(n);
+    if (n) value->listRange(from, n, item);
+}
+
+template <typename Header, typename Pair>
+void Database::hgetall(std::string_view key, Header&& header, Pair&& pair) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    const Value* value = lookupRead(shard, key, ValueType::Hash);
+    header(value ? value->hashSize() : 0);
+    if (value) value->hashForEach(pair);
+}
+
 #endif
\ No newline at end of file
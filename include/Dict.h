@@ -0,0 +1,350 @@
+#ifndef DICT_H
+#define DICT_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <tuple>
+#include <iterator>
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include <cstddef>
+
+// transparent hash -> maps keyed by std::string can be searched with a string_view (no temp string)
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+// chained hash table keyed by std::string, power of two buckets picked by the low hash bits
+// same surface as the unordered_map it replaces (find/emplace/erase/iteration) plus scan()
+// nodes never move -> pointers to values survive a rehash
+// resizing is incremental like redis: a second table is allocated and every insert (and rehashStep)
+// relinks a bucket or so from the old one -> no single command pays for relinking millions of nodes
+// grows when size reaches the bucket count, shrinks when it drops below a tenth of it
+template <typename V>
+class Dict {
+    struct Node {
+        std::pair<const std::string, V> kv;
+        size_t hash;
+        Node* next;
+    };
+
+    struct Table {
+        std::unique_ptr<Node*[]> buckets;
+        size_t mask = 0; //bucket count - 1
+
+        Table() = default;
+        explicit Table(size_t n) : buckets(new Node*[n]()), mask(n - 1) {}
+        size_t size() const { return buckets ? mask + 1 : 0; }
+    };
+
+public:
+    using value_type = std::pair<const std::string, V>;
+    static constexpr size_t NODE_BYTES = sizeof(Node); //one entry, key and value inline
+
+    template <bool Const>
+    class Iter {
+        using DictPtr = std::conditional_t<Const, const Dict*, Dict*>;
+    public:
+        using value_type = Dict::value_type;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iter() = default;
+        Iter(DictPtr d, Node* n) : dict(d), node(n) {}
+        operator Iter<true>() const { return Iter<true>(dict, node); }
+
+        reference operator*() const { return node->kv; }
+        pointer operator->() const { return &node->kv; }
+        Iter& operator++() {
+            node = node->next ? node->next : dict->firstFrom(dict->positionOf(node) + 1);
+            return *this;
+        }
+        template <bool C>
+        bool operator==(const Iter<C>& other) const { return node == other.node; }
+        template <bool C>
+        bool operator!=(const Iter<C>& other) const { return node != other.node; }
+
+    private:
+        friend class Dict;
+        DictPtr dict = nullptr;
+        Node* node = nullptr;
+    };
+
+    using iterator = Iter<false>;
+    using const_iterator = Iter<true>;
+
+    Dict() = default;
+    Dict(const Dict&) = delete;
+    Dict& operator=(const Dict&) = delete;
+    Dict(Dict&& other) noexcept { swap(other); }
+    Dict& operator=(Dict&& other) noexcept {
+        if (this != &other) {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+    ~Dict() { clear(); }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    //allocated buckets, both tables while rehashing -> what the bucket arrays cost
+    size_t bucketCount() const { return tables[0].size() + tables[1].size(); }
+    bool rehashing() const { return tables[1].buckets != nullptr; }
+
+    iterator begin() { return iterator(this, firstFrom(0)); }
+    iterator end() { return iterator(this, nullptr); }
+    const_iterator begin() const { return const_iterator(this, firstFrom(0)); }
+    const_iterator end() const { return const_iterator(this, nullptr); }
+
+    iterator find(std::string_view key) { return iterator(this, findNode(key, StringHash{}(key))); }
+    const_iterator find(std::string_view key) const { return const_iterator(this, findNode(key, StringHash{}(key))); }
+
+    //constructs the value from args only when the key is new
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(std::string key, Args&&... args) {
+        size_t h = StringHash{}(key);
+        if (Node* n = findNode(key, h)) return {iterator(this, n), false};
+        return {iterator(this, insertNode(std::move(key), h, std::forward<Args>(args)...)), true};
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(std::string key, M&& value) {
+        size_t h = StringHash{}(key);
+        if (Node* n = findNode(key, h)) {
+            n->kv.second = std::forward<M>(value);
+            return {iterator(this, n), false};
+        }
+        return {iterator(this, insertNode(std::move(key), h, std::forward<M>(value))), true};
+    }
+
+    //returns the entry after the erased one
+    //never relinks other nodes (a shrink is only started) -> safe while iterating,
+    //callers erasing a single key follow up with rehashStep() to keep a shrink moving
+    iterator erase(const_iterator pos) {
+        Node* target = pos.node;
+        iterator next(this, target);
+        ++next;
+        Node** link = &head(positionOf(target));
+        while (*link != target) link = &(*link)->next;
+        *link = target->next;
+        delete target;
+        count--;
+        shrinkIfSparse();
+        return next;
+    }
+
+    // relinks up to n buckets of the old table, gives up after n * 10 empty ones
+    // the old table is freed once the last one moved, false -> not rehashing (anymore)
+    bool rehashStep(size_t n = 1) {
+        if (!rehashing()) return false;
+        Table& from = tables[0];
+        Table& to = tables[1];
+        size_t emptyVisits = n * 10;
+        while (n > 0 && rehash_idx <= from.mask) {
+            Node* node = from.buckets[rehash_idx];
+            if (!node) {
+                rehash_idx++;
+                if (--emptyVisits == 0) break;
+                continue;
+            }
+            while (node) {
+                Node* next = node->next;
+                Node*& bucket = to.buckets[node->hash & to.mask];
+                node->next = bucket;
+                bucket = node;
+                node = next;
+            }
+            from.buckets[rehash_idx++] = nullptr;
+            n--;
+        }
+        if (rehash_idx <= from.mask) return true;
+        tables[0] = std::move(tables[1]);
+        tables[1] = Table();
+        rehash_idx = 0;
+        shrinkIfSparse(); //emptied further while it was rehashing
+        return rehashing();
+    }
+
+    //bucket count -> next power of two >= n in one go (bulk loads), never shrinks
+    void reserve(size_t n) {
+        size_t want = fit(n);
+        if (want > tables[0].size() && want > tables[1].size()) rehashAll(want);
+    }
+
+    void clear() {
+        for (Table& t : tables) {
+            for (size_t b = 0; b < t.size(); b++) {
+                for (Node* n = t.buckets[b]; n; ) {
+                    Node* next = n->next;
+                    delete n;
+                    n = next;
+                }
+            }
+            t = Table();
+        }
+        rehash_idx = 0;
+        count = 0;
+    }
+
+    // visits one bucket -> fn(key, value) for every entry in it, returns the next cursor (0 -> done)
+    // the cursor is a bucket index counted in bit reversed order (high bits first, like redis dictScan)
+    // growing splits bucket b into b and b + old size, which both come after b in that order
+    // -> an entry present for the whole scan is returned at least once no matter how often
+    // the table doubles or halves between calls (entries of an already visited bucket may come twice)
+    // while rehashing: the small table's bucket, then every bucket of the large one that expands from it
+    template <typename F>
+    size_t scan(size_t cursor, F&& fn) const {
+        if (!tables[0].buckets) return 0;
+        auto visit = [&](const Table& t) {
+            for (const Node* n = t.buckets[cursor & t.mask]; n; n = n->next)
+                fn(n->kv.first, n->kv.second);
+        };
+        if (!rehashing()) {
+            visit(tables[0]);
+            return nextCursor(cursor, tables[0].mask);
+        }
+        const Table* small = &tables[0];
+        const Table* large = &tables[1];
+        if (small->mask > large->mask) std::swap(small, large);
+        visit(*small);
+        do {
+            visit(*large);
+            cursor = nextCursor(cursor, large->mask);
+        } while (cursor & (small->mask ^ large->mask)); //until the carry reaches the small table's bits
+        return cursor;
+    }
+
+    // up to n entries -> fn(key, value), walking buckets in order from bucket start (like redis dictGetSomeKeys)
+    // cheap rather than uniform, enough for approximate eviction
+    // gives up after n * 10 buckets unless nothing was found yet -> a non empty dict always yields one
+    template <typename F>
+    void sample(size_t start, size_t n, F&& fn) const {
+        size_t total = bucketCount();
+        if (total == 0) return;
+        size_t found = 0;
+        size_t pos = start % total;
+        for (size_t steps = 0; steps < total && found < n && (steps < n * 10 || found == 0); steps++) {
+            for (const Node* node = head(pos); node && found < n; node = node->next, found++)
+                fn(node->kv.first, node->kv.second);
+            if (++pos == total) pos = 0;
+        }
+    }
+
+private:
+    static const size_t MIN_BUCKETS = 4;
+
+    //[0] -> the table, [1] -> its replacement while rehashing (bigger or smaller)
+    Table tables[2];
+    size_t rehash_idx = 0; //buckets of tables[0] below this one already moved to tables[1]
+    size_t count = 0;
+
+    void swap(Dict& other) noexcept {
+        std::swap(tables[0], other.tables[0]);
+        std::swap(tables[1], other.tables[1]);
+        std::swap(rehash_idx, other.rehash_idx);
+        std::swap(count, other.count);
+    }
+
+    static size_t fit(size_t n) {
+        size_t want = MIN_BUCKETS;
+        while (want < n) want <<= 1;
+        return want;
+    }
+
+    //buckets numbered across both tables: tables[0] first, then tables[1] (iteration + sampling order)
+    //a node sits in tables[1] exactly when its tables[0] bucket was already moved
+    size_t positionOf(const Node* n) const {
+        size_t b = n->hash & tables[0].mask;
+        if (rehashing() && b < rehash_idx) return tables[0].size() + (n->hash & tables[1].mask);
+        return b;
+    }
+
+    Node*& head(size_t pos) const {
+        if (pos < tables[0].size()) return tables[0].buckets[pos];
+        return tables[1].buckets[pos - tables[0].size()];
+    }
+
+    Node* findNode(std::string_view key, size_t h) const {
+        for (const Table& t : tables) {
+            if (!t.buckets) break;
+            for (Node* n = t.buckets[h & t.mask]; n; n = n->next) { //moved buckets are empty
+                if (n->hash == h && n->kv.first == key) return n;
+            }
+        }
+        return nullptr;
+    }
+
+    Node* firstFrom(size_t pos) const {
+        for (size_t total = bucketCount(); pos < total; pos++) {
+            if (Node* n = head(pos)) return n;
+        }
+        return nullptr;
+    }
+
+    template <typename... Args>
+    Node* insertNode(std::string&& key, size_t h, Args&&... args) {
+        if (!tables[0].buckets) tables[0] = Table(MIN_BUCKETS);
+        else if (!rehashing() && count + 1 > tables[0].size()) startRehash(tables[0].size() * 2); //load factor 1
+        rehashStep();
+        Node* n = new Node{value_type(std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                                      std::forward_as_tuple(std::forward<Args>(args)...)), h, nullptr};
+        Node*& bucket = head(positionOf(n)); //old table unless its bucket already moved
+        n->next = bucket;
+        bucket = n;
+        count++;
+        return n;
+    }
+
+    void shrinkIfSparse() {
+        if (!rehashing() && tables[0].size() > MIN_BUCKETS && count * 10 < tables[0].size())
+            startRehash(fit(count)); //load below 0.1
+    }
+
+    void startRehash(size_t buckets) {
+        tables[1] = Table(buckets);
+        rehash_idx = 0;
+    }
+
+    //relinks every node of both tables by its cached hash at once, nothing is copied or rehashed
+    void rehashAll(size_t buckets) {
+        Table fresh(buckets);
+        for (Table& t : tables) {
+            for (size_t b = 0; b < t.size(); b++) {
+                for (Node* n = t.buckets[b]; n; ) {
+                    Node* next = n->next;
+                    Node*& bucket = fresh.buckets[n->hash & fresh.mask];
+                    n->next = bucket;
+                    bucket = n;
+                    n = next;
+                }
+            }
+        }
+        tables[0] = std::move(fresh);
+        tables[1] = Table();
+        rehash_idx = 0;
+    }
+
+    static size_t nextCursor(size_t cursor, size_t mask) {
+        cursor |= ~mask;        //unused high bits set -> the increment carries straight through them
+        cursor = reverseBits(cursor);
+        cursor++;
+        return reverseBits(cursor);
+    }
+
+    //swap neighbouring bits, pairs, nibbles, then the bytes
+    static size_t reverseBits(size_t v) {
+        static_assert(sizeof(size_t) == 8, "64 bit cursors");
+        v = ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
+        v = ((v >> 2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) << 2);
+        v = ((v >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((v & 0x0F0F0F0F0F0F0F0Full) << 4);
+        return __builtin_bswap64(v);
+    }
+};
+
+#endif
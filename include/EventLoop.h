@@ -0,0 +1,90 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "RespParser.h"
+#include "RespWriter.h"
+
+class CommandHandler;
+
+// per connection state machine
+// Reading -> normal, Writing -> reply still pending (stop reading until flushed)
+// Closing -> peer hung up, flush whatever is left then close
+enum class ConnState {
+    Reading,
+    Writing,
+    Closing
+};
+
+struct Connection {
+    int fd;
+    ConnState state = ConnState::Reading;
+    std::string inbuf;  //[0, inlen) received, not processed yet (may end in a partial command), rest is recv room
+    size_t inlen = 0;   //inbuf only grows -> the room is zero filled once, not on every recv
+    RespParser parser;  //resumes the partial command at the tail of inbuf
+    std::vector<std::string_view> args; //views into inbuf, reused for every command -> no per command alloc
+    OutputBuffer outbuf; //reply bytes not sent yet, chunked, big values by reference -> writev
+    std::string addr;    //peer ip:port, for SLOWLOG
+    bool awaiting_fsync = false; //replies behind an appendfsync always group commit, not sent before it
+
+    Connection(int fd, std::string addr) : fd(fd), addr(std::move(addr)) {}
+};
+
+//per client buffer caps, like redis client-query-buffer-limit / client-output-buffer-limit
+//a client crossing one is disconnected -> one peer can not grow the server past maxmemory
+struct ClientLimits {
+    size_t query_buffer = size_t(1024) * 1024 * 1024; //unprocessed input, incl. one command being received
+    size_t output_buffer = 512 * 1024 * 1024;         //replies not sent yet, 0 -> no limit
+};
+
+extern ClientLimits clientLimits; //set once at startup before the reactors run
+
+// counters owned by one reactor, read by INFO from other threads
+struct ReactorStats {
+    std::atomic<uint64_t> connected_clients{0};
+    std::atomic<uint64_t> total_connections{0};
+    std::atomic<uint64_t> total_commands{0};
+    std::atomic<uint64_t> net_input_bytes{0};
+    std::atomic<uint64_t> net_output_bytes{0};
+};
+
+// edge triggered epoll reactor, owns the listening socket events and all its connections
+class EventLoop {
+public:
+    EventLoop(int id, int listen_fd, CommandHandler& handler);
+    ~EventLoop();
+
+    void run();
+    void stop(); //safe from a signal handler (only write() on eventfd)
+
+    int id() const { return loop_id; }
+    const ReactorStats& stats() const { return counters; }
+
+private:
+    int loop_id;
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd; //eventfd to break epoll_wait on stop
+    std::atomic<bool> running;
+    CommandHandler& cmdHandler;
+    ReactorStats counters;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::vector<int> deferred_writes; //replies held until the tick's AOF fsync
+    std::vector<int> resumed_reads;   //output drained while flushing those, or read budget used up -> read again next tick
+    bool flushing_deferred = false;
+
+    void acceptConnections();
+    void handleRead(Connection& conn);
+    void processInput(Connection& conn);
+    void handleWrite(Connection& conn);
+    void closeConnection(Connection& conn);
+    bool overLimits(Connection& conn); //logs + closes a client past clientLimits
+};
+
+#endif
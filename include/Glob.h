@@ -0,0 +1,13 @@
+#ifndef GLOB_H
+#define GLOB_H
+
+#include <string_view>
+
+// redis style glob: * any run, ? any char, [abc] [^abc] [a-z] classes, \x literal x
+// one backtrack point (the last *) -> linear in practice, no recursion on hostile patterns
+bool globMatch(std::string_view pattern, std::string_view text);
+
+//false -> pattern only matches itself, callers can do a plain lookup instead
+bool isGlobPattern(std::string_view pattern);
+
+#endif
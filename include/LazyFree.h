@@ -0,0 +1,64 @@
+#ifndef LAZY_FREE_H
+#define LAZY_FREE_H
+
+#include <string>
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "Value.h"
+
+// background reclamation, like redis lazyfree
+// UNLINK / FLUSHALL ASYNC / SET over a big value take the value out of the keyspace in O(1) under
+// the shard lock, this thread does the actual frees later -> a 5M item list never stalls a shard
+// values under THRESHOLD allocations are freed inline: cheaper than the handoff
+class LazyFree {
+public:
+    static const size_t THRESHOLD = 64; //same cut as redis LAZYFREE_THRESHOLD
+
+    static LazyFree& instance();
+
+    //roughly the number of allocations freeing the value takes
+    static size_t effort(const Value& value);
+
+    //value already out of the keyspace, no shard lock held: small -> left to the caller (freed inline
+    //when its owner goes out of scope), big -> moved to the background thread
+    void dispose(Value&& value);
+
+    //whole containers (a shard's dictionary for FLUSHALL ASYNC), objects -> keys in them, always queued
+    template <typename T>
+    void disposeAll(T&& garbage, size_t objects) {
+        auto owned = std::make_unique<Owned<std::decay_t<T>>>(std::forward<T>(garbage));
+        owned->objects = objects;
+        enqueue(std::move(owned));
+    }
+
+    size_t pendingObjects() const { return pending.load(std::memory_order_relaxed); }
+    uint64_t freedObjects() const { return freed.load(std::memory_order_relaxed); }
+
+private:
+    struct Garbage {
+        size_t objects = 1;
+        virtual ~Garbage() = default;
+    };
+    template <typename T>
+    struct Owned : Garbage {
+        T value;
+        explicit Owned(T&& v) : value(std::move(v)) {}
+    };
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::unique_ptr<Garbage>> queue;
+    std::atomic<size_t> pending{0};
+    std::atomic<uint64_t> freed{0};
+
+    LazyFree();
+    void enqueue(std::unique_ptr<Garbage> garbage);
+    void run(); //reclamation thread
+};
+
+#endif
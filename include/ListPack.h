@@ -0,0 +1,77 @@
+#ifndef LIST_PACK_H
+#define LIST_PACK_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// contiguous run of length prefixed strings, the building block of QuickList nodes
+// entry layout: [len varint][bytes][backlen] -> backlen lets us walk it backwards too
+// ~2 bytes overhead for a short element instead of a whole std::string per item
+// entries are addressed by byte offset, end() == one past the last entry
+class ListPack {
+public:
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t bytes() const { return buf.size(); }
+    //raw encoded bytes -> snapshots store them as is
+    std::string_view raw() const { return buf; }
+    //take over raw bytes from a snapshot, false (and untouched) when they do not walk cleanly
+    bool assign(std::string_view bytes);
+    //bytes an entry of this length would take (for node fill decisions)
+    static size_t entrySize(size_t len);
+
+    void pushBack(std::string_view value);
+    void pushFront(std::string_view value);
+    void insertAt(size_t offset, std::string_view value); //offset of an entry or end()
+    std::string popFront();
+    std::string popBack();
+
+    //offset cursor
+    size_t first() const { return 0; }
+    size_t end() const { return buf.size(); }
+    size_t last() const { return prev(buf.size()); } //list must not be empty
+    size_t next(size_t offset) const;
+    size_t prev(size_t offset) const; //offset must not be first()
+    std::string_view get(size_t offset) const;
+    size_t offsetOf(size_t index) const; //walks from the nearer end
+
+    void replace(size_t offset, std::string_view value);
+    size_t erase(size_t offset); //returns offset of the entry that followed
+    //drop up to limit entries equal to value, scanning from the tail when fromTail
+    size_t removeMatching(std::string_view value, size_t limit, bool fromTail);
+    //keep n entries starting at index start, drop the rest (two memmoves at most)
+    void keepRange(size_t start, size_t n);
+    //entries from offset on move into the returned pack, this one keeps the ones before
+    ListPack splitAt(size_t offset);
+
+    template <typename F>
+    void forEach(F&& fn) const {
+        for (size_t off = first(); off != end(); off = next(off))
+            fn(get(off));
+    }
+
+    //fn(item) returns false to stop -> walk() returns false too
+    template <typename F>
+    bool walk(bool fromTail, F&& fn) const {
+        if (!fromTail) {
+            for (size_t off = first(); off != end(); off = next(off))
+                if (!fn(get(off))) return false;
+            return true;
+        }
+        for (size_t off = end(); off != first(); ) {
+            off = prev(off);
+            if (!fn(get(off))) return false;
+        }
+        return true;
+    }
+
+private:
+    std::string buf;
+    uint32_t count = 0;
+
+    void encodeAt(size_t offset, std::string_view value);
+};
+
+#endif
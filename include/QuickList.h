@@ -0,0 +1,91 @@
+#ifndef QUICK_LIST_H
+#define QUICK_LIST_H
+
+#include "ListPack.h"
+
+#include <list>
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// list encoding: doubly linked list of small ListPack nodes
+// push/pop at either end is O(1) (only touches the head/tail node)
+// index/set skip whole nodes by their count, then walk inside one small node
+class QuickList {
+public:
+    //same default as redis list-max-listpack-size -2 -> node stops growing at 8KB
+    static const size_t NODE_MAX_BYTES = 8 * 1024;
+
+    size_t size() const { return total; }
+    bool empty() const { return total == 0; }
+    size_t nodeCount() const { return nodes.size(); }
+    //node buffers + per node overhead, kept up to date by every mutation -> O(1)
+    size_t bytes() const { return used_bytes + nodes.size() * NODE_OVERHEAD; }
+
+    void pushFront(std::string_view value);
+    void pushBack(std::string_view value);
+    bool popFront(std::string& value);
+    bool popBack(std::string& value);
+
+    //negative index counts from the tail
+    bool index(long idx, std::string& value) const;
+    bool set(long idx, std::string_view value);
+    //count > 0 head to tail, count < 0 tail to head, 0 -> all
+    size_t remove(std::string_view value, long count);
+    //keep n items from index start (start + n <= size), whole nodes outside are dropped
+    void trim(size_t start, size_t n);
+    //before / after the first item equal to pivot, false when there is none
+    bool insert(std::string_view pivot, std::string_view value, bool after);
+
+    template <typename F>
+    void forEach(F&& fn) const {
+        for (const auto& node : nodes)
+            node.forEach(fn);
+    }
+
+    //n items from index start (start + n <= size), skips whole nodes to get there
+    template <typename F>
+    void forRange(size_t start, size_t n, F&& fn) const {
+        if (n == 0) return;
+        size_t local;
+        auto it = locate(start, local);
+        size_t off = it->offsetOf(local);
+        while (true) {
+            fn(it->get(off));
+            if (--n == 0) return;
+            off = it->next(off);
+            if (off == it->end()) {
+                ++it;
+                off = it->first();
+            }
+        }
+    }
+
+    //fn(item) returns false to stop
+    template <typename F>
+    void walk(bool fromTail, F&& fn) const {
+        if (!fromTail) {
+            for (const auto& node : nodes)
+                if (!node.walk(false, fn)) return;
+            return;
+        }
+        for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+            if (!it->walk(true, fn)) return;
+    }
+
+private:
+    //ListPack object + the two links of its std::list node
+    static const size_t NODE_OVERHEAD = sizeof(ListPack) + 2 * sizeof(void*);
+
+    std::list<ListPack> nodes;
+    size_t total = 0;
+    size_t used_bytes = 0; //sum of node bytes()
+
+    static bool fits(const ListPack& node, size_t len);
+    //node holding element idx (0 based, in range) + index inside that node
+    std::list<ListPack>::iterator locate(size_t idx, size_t& local);
+    std::list<ListPack>::const_iterator locate(size_t idx, size_t& local) const;
+    bool normalize(long idx, size_t& out) const;
+};
+
+#endif
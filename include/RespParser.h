@@ -0,0 +1,48 @@
+#ifndef RESP_PARSER_H
+#define RESP_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+enum class ParseStatus {
+    Complete,   //one full command parsed, args filled
+    Incomplete, //need more bytes, progress is kept inside the parser
+    Error       //protocol error, see error()
+};
+
+// resumable RESP request parser (multibulk + inline) over a growing input buffer
+// the parser only remembers offsets into the buffer, so the buffer may grow (realloc) between calls
+// args of a Complete command are string_views into the buffer -> valid until the buffer is touched again
+// after a batch the caller drops the consumed prefix and calls discard() with the same count
+class RespParser {
+public:
+    ParseStatus parse(std::string_view buf, std::vector<std::string_view>& args);
+
+    //bytes at the front of the buffer that belong to already parsed commands
+    size_t consumed() const { return cmd_start; }
+    //caller erased n consumed bytes from the front of the buffer
+    void discard(size_t n);
+    //total buffer size needed to finish the bulk being read (0 if unknown) -> lets caller reserve once
+    size_t sizeHint() const;
+
+    const std::string& error() const { return err; }
+    void reset();
+
+private:
+    size_t cmd_start = 0;  //offset where the current command begins
+    size_t cursor = 0;     //offset of the next unparsed byte
+    long multibulk_len = -1; //bulk strings still to read, -1 -> array header not read yet
+    long bulk_len = -1;      //length of the bulk being read, -1 -> "$len" header not read yet
+    std::vector<std::pair<size_t, size_t>> spans; //offset, length of every finished arg
+    std::string err;
+
+    ParseStatus parseInline(std::string_view buf, std::vector<std::string_view>& args);
+    ParseStatus parseMultibulk(std::string_view buf, std::vector<std::string_view>& args);
+    void finish(std::string_view buf, std::vector<std::string_view>& args);
+    ParseStatus fail(const std::string& message);
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef RESP_WRITER_H
+#define RESP_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+
+// reply bytes of one connection waiting for the socket
+// small replies are copied into fixed size chunks -> a huge reply grows chunk by chunk,
+// never one giant string that keeps reallocating, and a sent chunk is reused for the next one
+// values of BIG_VALUE bytes or more are moved in as a segment of their own (no copy),
+// writev then sends chunks and big values together from one iovec list
+class OutputBuffer {
+public:
+    static const size_t CHUNK_SIZE = 16 * 1024;
+    static const size_t BIG_VALUE = 4 * 1024;
+
+    void append(std::string_view bytes);
+    void append(std::string&& bytes); //big -> own segment, small -> copied
+    //shared immutable buffer (a stored big value) -> referenced until sent, never copied
+    void append(std::shared_ptr<const std::string> bytes);
+    bool empty() const { return pending == 0; }
+    size_t size() const { return pending; } //bytes not sent yet
+
+    //iovecs over the unsent bytes in order, at most max of them, returns how many
+    int gather(iovec* iov, int max) const;
+    void consume(size_t n); //n bytes made it to the socket
+    void clear();
+    void truncate(size_t size); //drops unsent bytes past size (a reply abandoned half way)
+    std::string str() const; //everything pending as one string (non socket callers)
+
+private:
+    struct Segment {
+        std::string bytes;
+        bool chunk; //CHUNK_SIZE buffer we append into vs a moved in value
+        std::shared_ptr<const std::string> shared; //set -> bytes unused
+
+        std::string_view view() const { return shared ? std::string_view(*shared) : std::string_view(bytes); }
+    };
+
+    std::deque<Segment> segments;
+    size_t head_offset = 0; //bytes of segments.front() already sent
+    size_t pending = 0;
+    std::string spare; //one sent chunk kept for reuse
+
+    std::string& tailChunk(); //chunk with room at the back, new one if needed
+};
+
+// typed RESP replies appended to an OutputBuffer
+// integers are formatted with to_chars on the stack, headers for lengths below
+// CACHED_HEADERS come prebuilt -> a typical reply allocates nothing
+class RespWriter {
+public:
+    static const size_t CACHED_HEADERS = 1024;
+
+    explicit RespWriter(OutputBuffer& out) : out(out) {}
+
+    void simple(std::string_view text);  //+text
+    void error(std::string_view message); //-message, counted in errors()
+    void integer(long long value);        //:value
+    void bulk(std::string_view value);    //$len value
+    void bulk(std::string&& value);       //same, big values are handed over instead of copied
+    void bulk(std::shared_ptr<const std::string> value); //big stored value, zero copy into writev
+    void null();                          //$-1
+    void nullArray();                     //*-1
+    void arrayHeader(size_t count);       //*count, elements follow
+    void ok() { out.append(std::string_view("+OK\r\n")); }
+
+    size_t errors() const { return error_count; } //error replies written so far
+    size_t size() const { return out.size(); }     //bytes in the buffer, mark for rollback
+    void rollback(size_t size) { out.truncate(size); }
+
+private:
+    OutputBuffer& out;
+    size_t error_count = 0;
+
+    void header(char type, long long value);
+};
+
+#endif
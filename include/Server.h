@@ -3,22 +3,43 @@
 
 #include <string>
 #include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+
+class EventLoop;
+class CommandHandler;
 
 
 
 class Server{
 public:
-    Server(int port);
+    Server(int port, int reactors = 1);
+    ~Server();
     void run();
     void shutdown();
 
+    //per reactor connection / ops counters in INFO format
+    static std::string reactorInfo();
+    static std::string clientsInfo();
+    static std::string statsInfo(); //totals, instantaneous rates, error replies, shard lock waits
+
 private:
     int port;
-    int server_socket;
+    int reactor_count;
+    std::vector<int> listen_sockets; //one SO_REUSEPORT listener per reactor
     std::atomic<bool> running;
+    std::unique_ptr<CommandHandler> cmdHandler;
+    std::vector<std::unique_ptr<EventLoop>> loops;
+    std::vector<std::thread> reactor_threads;
+
+    int createListener();
+
+    //one sample of the reactor totals for the instantaneous rates, every 100ms while running
+    static void sampleStats();
 
     //signal handling for good healthy shutdown
     void setupSignalHandler();
 };
 
-#endif
\ No newline at end of file
+#endif
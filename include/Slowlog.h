@@ -0,0 +1,53 @@
+#ifndef SLOWLOG_H
+#define SLOWLOG_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+struct SlowlogEntry {
+    uint64_t id;
+    int64_t timestamp;        //unix seconds
+    uint64_t duration_us;
+    std::vector<std::string> args; //truncated like redis, see MAX_ARGS / MAX_ARG_LEN
+    std::string client;       //ip:port, empty for the aof replay
+};
+
+// commands slower than a threshold, kept in a fixed size ring (oldest overwritten) like redis SLOWLOG
+// every command pays one relaxed load for the check, only slow ones take the mutex
+// and the entry is built before it -> the lock covers a move into the ring slot
+class Slowlog {
+public:
+    static const size_t MAX_ARGS = 32;     //the last slot says how many more there were
+    static const size_t MAX_ARG_LEN = 128; //longer arguments end with how many bytes were cut
+
+    static Slowlog& instance();
+
+    //slowerThanUs < 0 -> off, 0 -> every command; maxLen 0 -> nothing kept
+    void configure(int64_t slowerThanUs, size_t maxLen);
+
+    bool isSlow(uint64_t durationUs) const {
+        int64_t limit = threshold.load(std::memory_order_relaxed);
+        return limit >= 0 && durationUs >= static_cast<uint64_t>(limit);
+    }
+    void record(const std::vector<std::string_view>& args, uint64_t durationUs, std::string_view client);
+
+    std::vector<SlowlogEntry> newest(size_t n) const; //copies, newest first
+    size_t length() const;
+    void reset();
+
+private:
+    std::atomic<int64_t> threshold{10000};
+    mutable std::mutex mutex;
+    std::vector<SlowlogEntry> ring; //max_len slots
+    size_t max_len = 128;
+    size_t head = 0;  //slot the next entry goes to
+    size_t count = 0; //filled slots
+    uint64_t next_id = 0;
+};
+
+#endif
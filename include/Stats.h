@@ -0,0 +1,79 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// counters that stay on permanently
+// every thread only ever writes its own ThreadStats -> a single writer needs no locked instruction
+// and no cache line is shared between reactors; INFO / LATENCY merge all threads on read
+
+//counter with exactly one writing thread: relaxed load + store instead of fetch_add
+class Counter {
+public:
+    void add(uint64_t n) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+// log linear (HDR style) latency buckets over nanoseconds
+// exact below 16ns, then 8 sub buckets per power of two -> a bucket is at most 12.5% wide
+// everything from 2^MAX_EXP ns (~18 minutes) on lands in the last bucket
+struct LatencyBuckets {
+    static const unsigned SUB_BITS = 3;
+    static const unsigned MAX_EXP = 40;
+    static const size_t LINEAR = size_t(2) << SUB_BITS; //16
+    static const size_t COUNT = LINEAR + (MAX_EXP - SUB_BITS - 1) * (size_t(1) << SUB_BITS) + 1; //+1 overflow
+
+    static size_t of(uint64_t ns);
+    static uint64_t high(size_t bucket); //largest ns that falls in bucket
+};
+
+struct CommandStats {
+    Counter calls;
+    Counter failed;   //ran and replied with an error
+    Counter rejected; //never ran: arity, OOM
+    Counter ns;       //total execution time
+    std::array<Counter, LatencyBuckets::COUNT> latency;
+};
+
+struct ThreadStats {
+    std::unique_ptr<CommandStats[]> commands; //indexed like the command table
+    Counter unknown_commands;
+    Counter lock_waits;   //shard lock acquires that had to block
+    Counter lock_wait_ns;
+};
+
+//this thread's stats, registered on first use and kept for the life of the process
+ThreadStats& threadStats();
+
+//sum of every thread, plain numbers
+struct CommandTotals {
+    uint64_t calls = 0;
+    uint64_t failed = 0;
+    uint64_t rejected = 0;
+    uint64_t ns = 0;
+    std::array<uint64_t, LatencyBuckets::COUNT> latency{};
+
+    uint64_t percentileNs(double p) const; //upper bound of the bucket holding the p-th call
+};
+
+std::vector<CommandTotals> commandTotals(); //indexed like the command table
+struct ThreadTotals {
+    uint64_t unknown_commands = 0;
+    uint64_t lock_waits = 0;
+    uint64_t lock_wait_ns = 0;
+};
+ThreadTotals threadTotals();
+
+//INFO sections built from the totals
+std::string commandStatsInfo(); //# Commandstats -> calls, time, failures per command
+std::string latencyStatsInfo(); //# Latencystats -> p50 / p99 / p99.9 per command
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <variant>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include "QuickList.h"
+#include "Dict.h"
+
+template <typename V>
+using StringMap = std::unordered_map<std::string, V, StringHash, std::equal_to<>>;
+
+enum class ValueType : uint8_t {
+    String,
+    List,
+    Hash
+};
+
+//how the payload is laid out in memory
+enum class ValueEncoding : uint8_t {
+    Raw,       //string -> std::string, or a shared immutable buffer from Value::SHARED_MIN bytes on
+    ListPack,  //small list -> items, small hash -> field,value,field,value... in one flat buffer
+    QuickList, //list -> linked ListPack nodes
+    HashTable  //hash -> Dict<std::string>
+};
+
+//small collections stay ListPack encoded until one of these is crossed, then convert for good
+//same knobs (and defaults) as redis list/hash-max-listpack-*
+struct EncodingLimits {
+    size_t list_max_listpack_entries = 128;
+    size_t list_max_listpack_value = 64;
+    size_t hash_max_listpack_entries = 128;
+    size_t hash_max_listpack_value = 64;
+};
+
+extern EncodingLimits encodingLimits; //set once at startup before any key exists
+
+//unix time in milliseconds -> expiry timestamps survive a restart
+inline int64_t nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+//heap bytes behind a std::string of that length, short ones live inside the object (SSO)
+inline size_t stringHeapBytes(size_t len) {
+    return len > 15 ? len + 1 : 0;
+}
+
+using ListValue = QuickList;
+using SharedString = std::shared_ptr<const std::string>;
+
+//hash table encoding, heap bytes of fields + values summed alongside -> memory accounting is O(1)
+struct HashValue : Dict<std::string> {
+    size_t payload = 0;
+};
+
+// string taken out of the keyspace, still valid once the shard lock is released
+// small -> copied (cheaper than a refcount round trip), big -> a reference to the stored buffer
+struct StringRef {
+    std::string copy;
+    SharedString shared;
+
+    std::string_view view() const { return shared ? std::string_view(*shared) : std::string_view(copy); }
+};
+
+// one entry of the keyspace: type tag + encoding + optional expiry + payload
+// the key lives in exactly one dictionary, so it can only ever have one type
+// lists and hashes go through the list*/hash* methods -> they pick the right encoding
+struct Value {
+    static const int64_t NO_EXPIRE = 0;
+
+    ValueType type;
+    ValueEncoding encoding;
+    //eviction clock, LRU time or LFU time + counter depending on the policy (Eviction.cpp)
+    //readers refresh it under the shared lock -> only ever touched through std::atomic_ref
+    mutable uint32_t lru = 0;
+    int64_t expire_at = NO_EXPIRE; //unix ms, NO_EXPIRE -> persistent
+    //big strings are never modified, SET swaps in a new buffer -> readers keep the old one alive
+    //same cut as OutputBuffer::BIG_VALUE, below it a reply copies the bytes anyway
+    static const size_t SHARED_MIN = 4 * 1024;
+
+    //hash table behind a pointer keeps every Value the size of a std::string payload
+    std::variant<std::string, ListPack, ListValue, std::unique_ptr<HashValue>, SharedString> data;
+
+    static Value makeString(std::string_view s) {
+        if (s.size() >= SHARED_MIN)
+            return makeString(std::make_shared<const std::string>(s));
+        return Value{.type = ValueType::String, .encoding = ValueEncoding::Raw, .data = std::string(s)};
+    }
+    static Value makeString(SharedString s) {
+        return Value{.type = ValueType::String, .encoding = ValueEncoding::Raw, .data = std::move(s)};
+    }
+    //new collections start compact
+    static Value makeList() {
+        return Value{.type = ValueType::List, .encoding = ValueEncoding::ListPack, .data = ListPack{}};
+    }
+    static Value makeHash() {
+        return Value{.type = ValueType::Hash, .encoding = ValueEncoding::ListPack, .data = ListPack{}};
+    }
+
+    bool isShared() const { return std::holds_alternative<SharedString>(data); }
+    std::string_view str() const {
+        if (isShared()) return *std::get<SharedString>(data);
+        return std::get<std::string>(data);
+    }
+    //reader side: copy of a small string, another reference to a big one
+    void strRead(StringRef& out) const {
+        if (isShared()) out.shared = std::get<SharedString>(data);
+        else out.copy = std::get<std::string>(data);
+    }
+    ListValue& list() { return std::get<ListValue>(data); }
+    const ListValue& list() const { return std::get<ListValue>(data); }
+    HashValue& hash() { return *std::get<std::unique_ptr<HashValue>>(data); }
+    const HashValue& hash() const { return *std::get<std::unique_ptr<HashValue>>(data); }
+    //ListPack encoded list or hash
+    ListPack& pack() { return std::get<ListPack>(data); }
+    const ListPack& pack() const { return std::get<ListPack>(data); }
+
+    //heap bytes owned beyond the Value itself, O(1) for every encoding
+    size_t memoryUsage() const;
+
+    bool hasExpire() const { return expire_at != NO_EXPIRE; }
+    bool isExpired(int64_t now) const { return expire_at != NO_EXPIRE && expire_at <= now; }
+
+    //list ops, negative index counts from the tail
+    size_t listSize() const;
+    void listPushFront(std::string_view item);
+    void listPushBack(std::string_view item);
+    bool listPopFront(std::string& item);
+    bool listPopBack(std::string& item);
+    bool listIndex(long idx, std::string& item) const;
+    bool listSet(long idx, std::string_view item);
+    size_t listRemove(std::string_view item, long count); //count like LREM
+
+    template <typename F>
+    void listForEach(F&& fn) const {
+        if (encoding == ValueEncoding::ListPack) pack().forEach(fn);
+        else list().forEach(fn);
+    }
+
+    //n items from index start (start + n <= size)
+    template <typename F>
+    void listRange(size_t start, size_t n, F&& fn) const {
+        if (encoding != ValueEncoding::ListPack) {
+            list().forRange(start, n, fn);
+            return;
+        }
+        const ListPack& lp = pack();
+        for (size_t off = n ? lp.offsetOf(start) : lp.end(); n > 0; n--, off = lp.next(off))
+            fn(lp.get(off));
+    }
+
+    //fn(item) returns false to stop, head to tail or tail to head
+    template <typename F>
+    void listWalk(bool fromTail, F&& fn) const {
+        if (encoding == ValueEncoding::ListPack) pack().walk(fromTail, fn);
+        else list().walk(fromTail, fn);
+    }
+
+    void listTrim(size_t start, size_t n); //keep n items from index start, n >= 1
+    bool listInsert(std::string_view pivot, std::string_view item, bool after); //false -> no pivot
+
+    //hash ops
+    size_t hashSize() const;
+    bool hashGet(std::string_view field, std::string& value) const;
+    bool hashExists(std::string_view field) const;
+    void hashSet(std::string_view field, std::string_view value);
+    bool hashDel(std::string_view field);
+
+    //fn(field, value) for every pair
+    template <typename F>
+    void hashForEach(F&& fn) const {
+        if (encoding == ValueEncoding::ListPack) {
+            const ListPack& lp = pack();
+            for (size_t off = lp.first(); off != lp.end(); ) {
+                size_t val = lp.next(off);
+                fn(lp.get(off), lp.get(val));
+                off = lp.next(val);
+            }
+        } else {
+            for (const auto& kv : hash())
+                fn(std::string_view(kv.first), std::string_view(kv.second));
+        }
+    }
+
+private:
+    size_t packFind(std::string_view field) const; //offset of the field entry or end()
+    void listConvert();
+    void hashConvert();
+};
+
+inline const char* typeName(ValueType type) {
+    switch (type) {
+        case ValueType::String: return "string";
+        case ValueType::List: return "list";
+        case ValueType::Hash: return "hash";
+    }
+    return "none";
+}
+
+inline const char* encodingName(ValueEncoding encoding) {
+    switch (encoding) {
+        case ValueEncoding::Raw: return "raw";
+        case ValueEncoding::ListPack: return "listpack";
+        case ValueEncoding::QuickList: return "quicklist";
+        case ValueEncoding::HashTable: return "hashtable";
+    }
+    return "unknown";
+}
+
+#endif
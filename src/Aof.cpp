@@ -0,0 +1,407 @@
+#include "../include/Aof.h"
+#include "../include/CommandHandler.h"
+#include "../include/Database.h"
+#include "../include/RespParser.h"
+#include "../include/RespWriter.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+AppendOnlyFile* AppendOnlyFile::activeAof = nullptr;
+
+//end offset of the last command this thread appended -> what waitDurable waits for
+static thread_local uint64_t lastAppend = 0;
+
+static const size_t REPLAY_CHUNK = 1 << 20;
+
+bool parseFsyncPolicy(std::string_view text, FsyncPolicy& out) {
+    if (text == "always") out = FsyncPolicy::Always;
+    else if (text == "everysec") out = FsyncPolicy::EverySec;
+    else if (text == "no") out = FsyncPolicy::No;
+    else return false;
+    return true;
+}
+
+const char* fsyncPolicyName(FsyncPolicy policy) {
+    switch (policy) {
+        case FsyncPolicy::Always: return "always";
+        case FsyncPolicy::EverySec: return "everysec";
+        case FsyncPolicy::No: return "no";
+    }
+    return "unknown";
+}
+
+//done -> bytes that made it into the file, also on failure
+static bool writeAll(int fd, const char* data, size_t len, size_t* done = nullptr) {
+    size_t total = 0;
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (done) *done = total;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        total += static_cast<size_t>(n);
+    }
+    if (done) *done = total;
+    return true;
+}
+
+static void appendBulk(std::string& out, std::string_view s) {
+    out.push_back('$');
+    out.append(std::to_string(s.size()));
+    out.append("\r\n");
+    out.append(s);
+    out.append("\r\n");
+}
+
+AppendOnlyFile::AppendOnlyFile(std::string filename, FsyncPolicy policy, size_t shardCount)
+    : filename(std::move(filename)), policy(policy), order_locks(shardCount) {}
+
+AppendOnlyFile::~AppendOnlyFile() {
+    close();
+}
+
+//one rewrite at a time -> fixed name
+std::string AppendOnlyFile::rewriteTempName() const {
+    return filename + ".rewrite";
+}
+
+bool AppendOnlyFile::open() {
+    //new (or empty) log -> start it from the current keyspace, or a restart would forget the snapshot data
+    struct stat st;
+    //written (and fsynced) beside it, renamed once complete -> a crash never leaves a torn first log
+    if (stat(filename.c_str(), &st) != 0 || st.st_size == 0) {
+        std::string tmp = rewriteTempName(); //no rewrite can run before open
+        if (!Database::getInstance().writeCommandLog(tmp) || ::rename(tmp.c_str(), filename.c_str()) != 0 ||
+            !syncParentDir(filename)) {
+            std::cerr << "aof: could not create " << filename << ": " << strerror(errno) << "\n";
+            unlink(tmp.c_str());
+            return false;
+        }
+    }
+    fd = ::open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "aof: could not open " << filename << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    if (fstat(fd, &st) == 0) file_size = static_cast<uint64_t>(st.st_size);
+
+    running = true;
+    flusher = std::thread([this]() { flushLoop(); });
+    activeAof = this;
+    return true;
+}
+
+void AppendOnlyFile::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+    }
+    wake.notify_one();
+    if (flusher.joinable()) flusher.join(); //last batch written + fsynced on the way out
+    if (activeAof == this) activeAof = nullptr;
+    ::close(fd);
+    fd = -1;
+}
+
+//lock only the shards the command's keys live in, ascending -> no deadlock between multi key writes
+//keyless writes (FLUSHALL) take every shard
+std::vector<std::unique_lock<std::mutex>> AppendOnlyFile::lockKeys(const CommandSpec& spec, const std::vector<std::string_view>& args) {
+    std::vector<size_t> idx;
+    if (spec.first_key <= 0) {
+        idx.resize(order_locks.size());
+        for (size_t i = 0; i < idx.size(); i++) idx[i] = i;
+    } else {
+        Database& db = Database::getInstance();
+        size_t last = spec.last_key < 0 ? args.size() - 1 : static_cast<size_t>(spec.last_key);
+        size_t step = spec.key_step > 0 ? static_cast<size_t>(spec.key_step) : 1;
+        for (size_t i = static_cast<size_t>(spec.first_key); i <= last && i < args.size(); i += step)
+            idx.push_back(db.shardOf(args[i]));
+        std::sort(idx.begin(), idx.end());
+        idx.erase(std::unique(idx.begin(), idx.end()), idx.end());
+    }
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(idx.size());
+    for (size_t i : idx) locks.emplace_back(order_locks[i]);
+    return locks;
+}
+
+//caller holds lockKeys for this command
+void AppendOnlyFile::feed(const std::vector<std::string_view>& args) {
+    std::string cmd;
+    cmd.push_back('*');
+    cmd.append(std::to_string(args.size()));
+    cmd.append("\r\n");
+    for (auto arg : args) appendBulk(cmd, arg);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    bool idle = buf.empty();
+    buf.append(cmd);
+    if (rewriting) rewrite_buf.append(cmd);
+    appended += cmd.size();
+    lastAppend = appended;
+    if (idle) wake.notify_one(); //opens the next group commit window
+}
+
+bool AppendOnlyFile::needsSync() const {
+    if (policy != FsyncPolicy::Always) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastAppend > synced;
+}
+
+//every reactor waiting here in the same millisecond shares one fsync
+bool AppendOnlyFile::waitDurable() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (synced >= lastAppend) return true;
+    if (!write_error) {
+        sync_waiters++;
+        wake.notify_one();
+        durable.wait(lock, [this]() { return synced >= lastAppend || !running || write_error; });
+        sync_waiters--;
+    }
+    if (synced >= lastAppend) return true;
+    lastAppend = 0; //caller fails these clients, the next tick starts clean
+    return false;
+}
+
+void AppendOnlyFile::flushLoop() {
+    using namespace std::chrono;
+    auto lastSync = steady_clock::now();
+    uint64_t written = synced; //offsets handed to write()
+    std::string out;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        auto pending = [this]() { return !running || !buf.empty() || rewrite_status != -1; };
+        //idle -> sleep until the first append (or the everysec tick)
+        wake.wait_for(lock, seconds(1), pending);
+        //group commit window: 1ms of appends from every reactor, cut short when an Always client waits
+        wake.wait_for(lock, milliseconds(1), [this]() {
+            return !running || (sync_waiters > 0 && !buf.empty()) || rewrite_status != -1;
+        });
+        if (rewriting && rewrite_status != -1) {
+            finishRewrite(lock);
+            written = synced;
+        }
+        //failing disk -> retry every 100ms instead of spinning on it
+        if (write_error && running) wake.wait_for(lock, milliseconds(100), [this]() { return !running; });
+
+        bool stopping = !running;
+        bool dueSync = policy != FsyncPolicy::No && (policy == FsyncPolicy::Always || stopping || write_error ||
+                                                     steady_clock::now() - lastSync >= seconds(1));
+        if (buf.empty() && !(dueSync && written > synced)) {
+            if (stopping) break;
+            continue;
+        }
+
+        out.swap(buf);
+        uint64_t end = appended;
+        lock.unlock();
+
+        size_t done = 0;
+        bool wrote = writeAll(fd, out.data(), out.size(), &done);
+        int err = wrote ? 0 : errno;
+        //half a batch in the file -> cut it off so the retry appends whole commands, like redis
+        if (!wrote && done > 0 && ftruncate(fd, static_cast<off_t>(file_size.load(std::memory_order_relaxed))) == 0)
+            done = 0;
+        bool fsynced = false;
+        if (wrote && dueSync) {
+            fsynced = fdatasync(fd) == 0;
+            if (!fsynced) err = errno;
+            lastSync = steady_clock::now();
+        }
+
+        lock.lock();
+        size_t batch = out.size();
+        if (wrote) {
+            written = end;
+        } else {
+            //unwritten part goes back in front of newer appends -> retried, nobody is told it is on disk
+            written = end - (batch - done);
+            buf.insert(0, out, done, std::string::npos);
+        }
+        out.clear();
+        if (done) {
+            writes.fetch_add(1, std::memory_order_relaxed);
+            file_size.fetch_add(done, std::memory_order_relaxed);
+            if (done > max_batch.load(std::memory_order_relaxed)) max_batch.store(done, std::memory_order_relaxed);
+        }
+        if (fsynced) {
+            fsyncs.fetch_add(1, std::memory_order_relaxed);
+            synced = end;
+        }
+        if (err) {
+            if (!write_error) std::cerr << "aof: " << (wrote ? "fsync" : "write") << " failed: " << strerror(err)
+                                        << ", refusing writes until it works again\n";
+            write_error = true;
+            write_errno = err;
+        } else if (write_error && wrote && (fsynced || policy == FsyncPolicy::No)) {
+            std::cerr << "aof: writes to " << filename << " work again\n";
+            write_error = false;
+        }
+        if (fsynced || err) durable.notify_all();
+        if (stopping) {
+            if (!wrote) std::cerr << "aof: " << (batch - done) << " bytes could not be written at shutdown\n";
+            break;
+        }
+    }
+}
+
+//child is done: its file + everything written since the fork becomes the new log
+//runs with the mutex held -> appends wait for the side buffer to be written, like redis does in its main thread
+bool AppendOnlyFile::finishRewrite(std::unique_lock<std::mutex>& /*lock*/) {
+    int status = rewrite_status;
+    std::string tmp = rewriteTempName();
+    rewriting = false;
+    rewrite_status = -1;
+    rewrite_child = -1;
+
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    int newFd = ok ? ::open(tmp.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC) : -1;
+    ok = newFd >= 0 && writeAll(newFd, rewrite_buf.data(), rewrite_buf.size()) &&
+         fdatasync(newFd) == 0 && ::rename(tmp.c_str(), filename.c_str()) == 0;
+    std::string().swap(rewrite_buf);
+    if (!ok) {
+        if (newFd >= 0) ::close(newFd);
+        unlink(tmp.c_str());
+        last_rewrite_ok = false;
+        std::cerr << "aof: rewrite failed, keeping the old log\n";
+        return false;
+    }
+
+    //the new log is in place either way, only the name may not survive a crash yet
+    if (!syncParentDir(filename))
+        std::cerr << "aof: could not fsync the directory of " << filename << ": " << strerror(errno) << "\n";
+    ::close(fd);
+    fd = newFd;
+    buf.clear(); //already part of the side buffer
+    synced = appended;
+    write_error = false; //the new log holds everything, whatever the old one failed on
+    struct stat st;
+    if (fstat(fd, &st) == 0) file_size = static_cast<uint64_t>(st.st_size);
+    rewrites.fetch_add(1, std::memory_order_relaxed);
+    last_rewrite_ok = true;
+    durable.notify_all();
+    return true;
+}
+
+bool AppendOnlyFile::rewriteInBackground() {
+    //no write may sit between execute and feed at the fork -> it would land in the child's file and the side buffer
+    std::vector<std::unique_lock<std::mutex>> order;
+    order.reserve(order_locks.size());
+    for (auto& m : order_locks) order.emplace_back(m);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (rewriting) return false;
+
+    pid_t pid = Database::getInstance().forkCommandLog(rewriteTempName());
+    if (pid < 0) {
+        std::cerr << "aof: fork failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    rewriting = true;
+    rewrite_child = pid;
+    rewrite_status = -1;
+    rewrite_buf.clear();
+
+    //reaper -> hands the exit status to the flusher, which swaps the files
+    std::thread([this, pid]() {
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        std::lock_guard<std::mutex> lock(mutex);
+        rewrite_status = status;
+        wake.notify_one();
+    }).detach();
+    return true;
+}
+
+//read the log in big chunks and run every command through the normal dispatch
+bool AppendOnlyFile::replay(const std::string& filename, CommandHandler& handler, uint64_t& commands) {
+    commands = 0;
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return errno == ENOENT;
+
+    std::string buf;
+    RespParser parser;
+    std::vector<std::string_view> args;
+    OutputBuffer sink;
+    RespWriter out(sink);
+    uint64_t base = 0; //file offset of buf[0]
+    bool ok = true;
+    while (ok) {
+        size_t used = buf.size();
+        buf.resize(used + REPLAY_CHUNK);
+        ssize_t n = read(fd, &buf[used], REPLAY_CHUNK);
+        int err = errno;
+        if (n < 0 && err == EINTR) {
+            buf.resize(used);
+            continue;
+        }
+        buf.resize(used + (n > 0 ? n : 0));
+        if (n == 0) break; //end of file
+        if (n < 0) {
+            //not the end of the log -> fail the load, the file is left as it is
+            std::cerr << "aof: read failed at offset " << base + used << ": " << strerror(err) << "\n";
+            ok = false;
+            break;
+        }
+
+        while (true) {
+            ParseStatus status = parser.parse(buf, args);
+            if (status == ParseStatus::Incomplete) break;
+            if (status == ParseStatus::Error) {
+                std::cerr << "aof: bad command at offset " << base + parser.consumed() << ": " << parser.error() << "\n";
+                ok = false;
+                break;
+            }
+            if (args.empty()) continue;
+            handler.processCommand(args, out);
+            sink.clear(); //replies of a replay go nowhere
+            commands++;
+        }
+        size_t consumed = parser.consumed();
+        buf.erase(0, consumed);
+        parser.discard(consumed);
+        base += consumed;
+    }
+    ::close(fd);
+
+    //crash in the middle of a write -> drop the torn tail, everything before it is intact
+    //only reached at a clean EOF: a read error or a bad command leaves ok false and never truncates
+    if (ok && !buf.empty()) {
+        std::cerr << "aof: truncated last command, cutting " << buf.size() << " bytes at offset " << base << "\n";
+        if (truncate(filename.c_str(), static_cast<off_t>(base)) != 0) ok = false;
+    }
+    return ok;
+}
+
+std::string AppendOnlyFile::info() const {
+    std::ostringstream oss;
+    std::lock_guard<std::mutex> lock(mutex);
+    oss << "# Append only file\r\n";
+    oss << "aof_enabled:1\r\n";
+    oss << "aof_fsync:" << fsyncPolicyName(policy) << "\r\n";
+    oss << "aof_size:" << file_size.load(std::memory_order_relaxed) << "\r\n";
+    oss << "aof_buffer_bytes:" << buf.size() << "\r\n";
+    oss << "aof_writes:" << writes.load(std::memory_order_relaxed) << "\r\n";
+    oss << "aof_fsyncs:" << fsyncs.load(std::memory_order_relaxed) << "\r\n";
+    oss << "aof_max_batch_bytes:" << max_batch.load(std::memory_order_relaxed) << "\r\n";
+    oss << "aof_rewrite_in_progress:" << (rewriting ? 1 : 0) << "\r\n";
+    oss << "aof_rewrites:" << rewrites.load(std::memory_order_relaxed) << "\r\n";
+    oss << "aof_last_rewrite_status:" << (last_rewrite_ok ? "ok" : "err") << "\r\n";
+    oss << "aof_last_write_status:" << (write_error ? "err" : "ok") << "\r\n";
+    if (write_error) oss << "aof_last_write_error:" << strerror(write_errno) << "\r\n";
+    return oss.str();
+}
@@ -1,79 +1,208 @@
 #include "../include/CommandHandler.h"
 //include data base also --done bro
 #include "../include/Database.h"
+#include "../include/Server.h"
+#include "../include/RespParser.h"
+#include "../include/Aof.h"
+#include "../include/RespWriter.h"
+#include "../include/Stats.h"
+#include "../include/Slowlog.h"
 
 #include <vector>
-#include <sstream>
 #include <algorithm>
 #include <exception>
 #include <iostream>
+#include <charconv>
+#include <cctype>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <climits>
+#include <chrono>
+
+
+//integer argument without building a std::string (stoi needs one)
+template <typename T>
+static bool toInt(std::string_view text, T& out) {
+    auto res = std::from_chars(text.data(), text.data() + text.size(), out);
+    return res.ec == std::errc() && res.ptr == text.data() + text.size();
+}
 
-
-std::vector<std::string> parseRespCommand(const std::string &input){
-    std::vector<std::string> tokens;
-    if(input.empty() == true){
-        return tokens;
+//command names are matched case insensitive in place, no lower-cased copy
+static bool iequals(std::string_view a, std::string_view lower) {
+    if (a.size() != lower.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (::tolower(static_cast<unsigned char>(a[i])) != lower[i]) return false;
     }
+    return true;
+}
 
-    // no start with * split by whitespace lol
-    if(input[0] != '*'){
-        std::istringstream iss(input); //like i am reading input from file or smthg
+//what the append only file records instead of the command as sent, filled by a handler while the
+//aof is on (EXPIRE -> PEXPIREAT with the deadline actually stored), reactor thread local
+static thread_local std::vector<std::string> logAs;
 
-        std::string token;
-        while(iss >> token){
-            tokens.push_back(token);
-        }
-        return tokens;
-    }
-    size_t pos = 0;
+//common commands
 
-    if(input[pos] != '*'){
-        return tokens;
-    }
-    pos++; //skip the * came
+static void handlePing(const std::vector<std::string_view>& /*tokens*/, Database& /*db*/, RespWriter& out) {
+    out.simple("PONG");
+}
 
-    size_t crlf = input.find("\r\n", pos);
-    if(crlf == std::string::npos){
-        return tokens;
-    }
+static void handleEcho(const std::vector<std::string_view>& tokens, Database& /*db*/, RespWriter& out) {
+    out.simple(tokens[1]);
+}
 
-    int numElements = std::stoi(input.substr(pos, crlf - pos));
-    pos = crlf + 2;
+static std::string aofInfo(Database& /*db*/) {
+    AppendOnlyFile* aof = AppendOnlyFile::active();
+    return aof ? aof->info() : "# Append only file\r\naof_enabled:0\r\n";
+}
 
+//INFO [section ...] -> no section = the default ones, "all" / "everything" adds the per command stats
+static void handleInfo(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    struct Section {
+        std::string_view name;
+        bool byDefault;
+        std::string (*build)(Database& db);
+    };
+    static const Section sections[] = {
+        {"reactors",     true,  [](Database&) { return Server::reactorInfo(); }},
+        {"clients",      true,  [](Database&) { return Server::clientsInfo(); }},
+        {"stats",        true,  [](Database&) { return Server::statsInfo(); }},
+        {"memory",       true,  [](Database& d) { return d.memoryInfo(); }},
+        {"expiry",       true,  [](Database& d) { return d.expiryInfo(); }},
+        {"persistence",  true,  [](Database& d) { return d.persistenceInfo(); }},
+        {"appendonly",   true,  aofInfo},
+        {"commandstats", false, [](Database&) { return commandStatsInfo(); }},
+        {"latencystats", false, [](Database&) { return latencyStatsInfo(); }},
+    };
+
+    bool all = false;
+    bool defaults = tokens.size() == 1;
+    for (size_t i = 1; i < tokens.size(); i++) {
+        if (iequals(tokens[i], "all") || iequals(tokens[i], "everything")) all = true;
+        else if (iequals(tokens[i], "default")) defaults = true;
+    }
 
-    for (int i = 0; i < numElements; i++) {
-        if (pos >= input.size() || input[pos] != '$') break; // format error
-        pos++; // skip '$'
+    std::string info;
+    for (const auto& section : sections) {
+        bool wanted = all || (defaults && section.byDefault);
+        for (size_t i = 1; i < tokens.size() && !wanted; i++) wanted = iequals(tokens[i], section.name);
+        if (!wanted) continue;
+        if (!info.empty()) info += "\r\n";
+        info += section.build(db);
+    }
+    out.bulk(std::move(info));
+}
 
-        crlf = input.find("\r\n", pos);
-        if (crlf == std::string::npos) break;
-        int len = std::stoi(input.substr(pos, crlf - pos));
-        pos = crlf + 2;
+//SLOWLOG GET [n] -> newest first, each [id, unix time, usec, [args], client, name (always empty)]
+//SLOWLOG LEN, SLOWLOG RESET
+static void handleSlowlog(const std::vector<std::string_view>& tokens, Database& /*db*/, RespWriter& out) {
+    Slowlog& slowlog = Slowlog::instance();
+    if (iequals(tokens[1], "len") && tokens.size() == 2)
+        return out.integer(static_cast<long long>(slowlog.length()));
+    if (iequals(tokens[1], "reset") && tokens.size() == 2) {
+        slowlog.reset();
+        return out.ok();
+    }
+    if (!iequals(tokens[1], "get") || tokens.size() > 3)
+        return out.error("Error: Unknown SLOWLOG subcommand or wrong number of arguments");
+
+    long long count = 10;
+    if (tokens.size() == 3 && (!toInt(tokens[2], count) || count < -1))
+        return out.error("Error: count should be greater than or equal to -1");
+    std::vector<SlowlogEntry> entries = slowlog.newest(count == -1 ? SIZE_MAX : static_cast<size_t>(count));
+    out.arrayHeader(entries.size());
+    for (const auto& entry : entries) {
+        out.arrayHeader(6);
+        out.integer(static_cast<long long>(entry.id));
+        out.integer(entry.timestamp);
+        out.integer(static_cast<long long>(entry.duration_us));
+        out.arrayHeader(entry.args.size());
+        for (const auto& arg : entry.args) out.bulk(std::string_view(arg));
+        out.bulk(std::string_view(entry.client));
+        out.bulk(std::string_view());
+    }
+}
 
-        if (pos + len > input.size()) break;
-        std::string token = input.substr(pos, len);
-        tokens.push_back(token);
-        pos += len + 2; // skip token and CRLF
+//LATENCY HISTOGRAM [command ...] -> per command: calls + cumulative counts at power of two usec bounds
+static void appendLatencyHistogram(RespWriter& out, std::string_view name, const CommandTotals& t) {
+    //fine ns buckets folded into 1, 2, 4, 8 ... usec
+    std::array<uint64_t, 64> perBound{};
+    unsigned top = 0;
+    for (size_t b = 0; b < t.latency.size(); b++) {
+        if (!t.latency[b]) continue;
+        uint64_t usec = (LatencyBuckets::high(b) + 999) / 1000;
+        unsigned bound = usec <= 1 ? 0 : 64 - __builtin_clzll(usec - 1);
+        perBound[bound] += t.latency[b];
+        top = std::max(top, bound);
+    }
+    size_t used = 0;
+    for (unsigned k = 0; k <= top; k++)
+        if (perBound[k]) used++;
+
+    out.bulk(name);
+    out.arrayHeader(4);
+    out.bulk(std::string_view("calls"));
+    out.integer(static_cast<long long>(t.calls));
+    out.bulk(std::string_view("histogram_usec"));
+    out.arrayHeader(used * 2);
+    uint64_t cumulative = 0;
+    for (unsigned k = 0; k <= top; k++) {
+        if (!perBound[k]) continue;
+        cumulative += perBound[k];
+        out.integer(1LL << k);
+        out.integer(static_cast<long long>(cumulative));
     }
-    return tokens;
 }
 
+static void handleLatency(const std::vector<std::string_view>& tokens, Database& /*db*/, RespWriter& out) {
+    if (!iequals(tokens[1], "histogram"))
+        return out.error("Error: Unknown LATENCY subcommand");
+    std::vector<CommandTotals> totals = commandTotals();
+    std::vector<size_t> picked;
+    if (tokens.size() == 2) {
+        for (size_t i = 0; i < totals.size(); i++)
+            if (totals[i].calls) picked.push_back(i);
+    } else {
+        for (size_t i = 2; i < tokens.size(); i++) {
+            const CommandSpec* spec = lookupCommand(tokens[i]);
+            if (!spec) continue;
+            size_t index = static_cast<size_t>(spec - &commandAt(0));
+            if (totals[index].calls && std::find(picked.begin(), picked.end(), index) == picked.end())
+                picked.push_back(index);
+        }
+    }
+    out.arrayHeader(picked.size() * 2); //RESP2 -> flat name, details pairs
+    for (size_t index : picked) appendLatencyHistogram(out, commandAt(index).name, totals[index]);
+}
 
-//common commands
+static void handleSave(const std::vector<std::string_view>& /*tokens*/, Database& db, RespWriter& out) {
+    if (db.dump("dump.my_rdb")) out.ok();
+    else out.error("Error: snapshot failed");
+}
 
-static std::string handlePing(const std::vector<std::string>& /*tokens*/, Database& /*db*/) {
-    return "+PONG\r\n";
+static void handleBgsave(const std::vector<std::string_view>& /*tokens*/, Database& db, RespWriter& out) {
+    if (!db.bgsave("dump.my_rdb"))
+        return out.error("Error: background save already in progress");
+    out.simple("Background saving started");
 }
 
-static std::string handleEcho(const std::vector<std::string>& tokens, Database& /*db*/) {
-    if (tokens.size() < 2)
-        return "-Error: ECHO requires a message\r\n";
-    return "+" + tokens[1] + "\r\n";
+static void handleBgrewriteaof(const std::vector<std::string_view>& /*tokens*/, Database& /*db*/, RespWriter& out) {
+    AppendOnlyFile* aof = AppendOnlyFile::active();
+    if (!aof)
+        return out.error("Error: appendonly is off");
+    if (!aof->rewriteInBackground())
+        return out.error("Error: background append only file rewriting already in progress");
+    out.simple("Background append only file rewriting started");
 }
 
-static std::string handleFlushAll(const std::vector<std::string>& /*tokens*/, Database& db) {
-    db.flushAll();
-    return "+OK\r\n";
+//FLUSHALL [ASYNC|SYNC] -> ASYNC hands the old dictionaries to the lazy free thread
+static void handleFlushAll(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    bool async = false;
+    if (tokens.size() == 2 && iequals(tokens[1], "async")) async = true;
+    else if (tokens.size() > 2 || (tokens.size() == 2 && !iequals(tokens[1], "sync")))
+        return out.error("Error: syntax error");
+    db.flushAll(async);
+    out.ok();
 }
 
 
@@ -81,329 +210,664 @@ static std::string handleFlushAll(const std::vector<std::string>& /*tokens*/, Da
 //-----
 //-----
 //key value ops
-static std::string handleSet(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 3)
-        return "-Error: SET requires key and value\r\n";
+static void handleSet(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
     db.set(tokens[1], tokens[2]);
-    return "+OK\r\n";
+    out.ok();
 }
 
-static std::string handleGet(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2)
-        return "-Error: GET requires key\r\n";
-    std::string value;
+//big value -> the stored buffer itself goes into the output, sent by writev without a copy
+static void bulkString(RespWriter& out, StringRef& value) {
+    if (value.shared) out.bulk(std::move(value.shared));
+    else out.bulk(std::move(value.copy));
+}
+
+static void handleGet(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    StringRef value;
     if (db.get(tokens[1], value))
-        return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
-    return "$-1\r\n";
+        return bulkString(out, value);
+    out.null();
 }
 
-static std::string handleKeys(const std::vector<std::string>& /*tokens*/, Database& db) {
-    auto allKeys = db.keys();
-    std::ostringstream oss;
-    oss << "*" << allKeys.size() << "\r\n";
-    for (const auto& key : allKeys)
-        oss << "$" << key.size() << "\r\n" << key << "\r\n";
-    return oss.str();
+static void handleMget(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    std::vector<std::string_view> keys(tokens.begin() + 1, tokens.end());
+    auto values = db.mget(keys);
+    out.arrayHeader(values.size());
+    for (auto& v : values) {
+        if (v) bulkString(out, *v);
+        else out.null();
+    }
 }
 
-static std::string handleType(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2)
-        return "-Error: TYPE requires key\r\n";
-    return "+" + db.type(tokens[1]) + "\r\n";
+//key value key value ... -> pairs, false when a value is missing
+static bool keyValuePairs(const std::vector<std::string_view>& tokens,
+                          std::vector<std::pair<std::string_view, std::string_view>>& pairs) {
+    if ((tokens.size() % 2) == 0) return false;
+    pairs.reserve((tokens.size() - 1) / 2);
+    for (size_t i = 1; i < tokens.size(); i += 2)
+        pairs.emplace_back(tokens[i], tokens[i + 1]);
+    return true;
 }
 
-static std::string handleDel(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2)
-        return "-Error: DEL requires key\r\n";
-    bool res = db.del(tokens[1]);
-    return ":" + std::to_string(res ? 1 : 0) + "\r\n";
+static void handleMset(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    std::vector<std::pair<std::string_view, std::string_view>> pairs;
+    if (!keyValuePairs(tokens, pairs))
+        return out.error("Error: wrong number of arguments for 'mset' command");
+    db.mset(pairs);
+    out.ok();
 }
 
-static std::string handleExpire(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 3)
-        return "-Error: EXPIRE requires key and time in seconds\r\n";
-    try {
-        int seconds = std::stoi(tokens[2]);
-        if (db.expire(tokens[1], seconds))
-            return "+OK\r\n";
-        else
-            return "-Error: Key not found\r\n";
-    } catch (const std::exception&) {
-        return "-Error: Invalid expiration time\r\n";
+static void handleMsetnx(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    std::vector<std::pair<std::string_view, std::string_view>> pairs;
+    if (!keyValuePairs(tokens, pairs))
+        return out.error("Error: wrong number of arguments for 'msetnx' command");
+    out.integer(db.msetnx(pairs) ? 1 : 0);
+}
+
+//KEYS [pattern], no pattern -> every key
+static void handleKeys(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    if (tokens.size() > 2)
+        return out.error("Error: wrong number of arguments for 'keys' command");
+    auto keys = db.keys(tokens.size() == 2 ? tokens[1] : std::string_view("*"));
+    out.arrayHeader(keys.size());
+    for (const auto& key : keys) out.bulk(key);
+}
+
+//[MATCH pattern] [COUNT n] [TYPE t] after the cursor, TYPE only when allowType, nullptr -> ok
+static const char* scanOptions(const std::vector<std::string_view>& tokens, size_t from, bool allowType,
+                               std::string_view& pattern, size_t& count, std::optional<ValueType>& type) {
+    for (size_t i = from; i < tokens.size(); i += 2) {
+        if (i + 1 >= tokens.size())
+            return "Error: syntax error";
+        std::string_view arg = tokens[i + 1];
+        if (iequals(tokens[i], "match")) {
+            pattern = arg;
+        } else if (iequals(tokens[i], "count")) {
+            if (!toInt(arg, count) || count < 1)
+                return "Error: COUNT must be a positive integer";
+        } else if (allowType && iequals(tokens[i], "type")) {
+            if (iequals(arg, "string")) type = ValueType::String;
+            else if (iequals(arg, "list")) type = ValueType::List;
+            else if (iequals(arg, "hash")) type = ValueType::Hash;
+            else return "Error: unknown type name";
+        } else {
+            return "Error: syntax error";
+        }
+    }
+    return nullptr;
+}
+
+//[next cursor, [items]] -> caller writes the items
+static void scanReply(RespWriter& out, uint64_t next, size_t items) {
+    char buf[24];
+    char* end = std::to_chars(buf, buf + sizeof(buf), next).ptr;
+    out.arrayHeader(2);
+    out.bulk(std::string_view(buf, end - buf));
+    out.arrayHeader(items);
+}
+
+//SCAN cursor [MATCH pattern] [COUNT n] [TYPE t] -> [next cursor, [keys]]
+static void handleScan(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    uint64_t cursor;
+    if (!toInt(tokens[1], cursor))
+        return out.error("Error: invalid cursor");
+    std::string_view pattern;
+    size_t count = 10;
+    std::optional<ValueType> type;
+    if (const char* err = scanOptions(tokens, 2, true, pattern, count, type))
+        return out.error(err);
+
+    std::vector<std::string> keys;
+    uint64_t next = db.scan(cursor, count, pattern, type, keys);
+    scanReply(out, next, keys.size());
+    for (const auto& key : keys) out.bulk(key);
+}
+
+//HSCAN key cursor [MATCH pattern] [COUNT n] -> [next cursor, [field, value, ...]]
+static void handleHscan(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    uint64_t cursor;
+    if (!toInt(tokens[2], cursor))
+        return out.error("Error: invalid cursor");
+    std::string_view pattern;
+    size_t count = 10;
+    std::optional<ValueType> type;
+    if (const char* err = scanOptions(tokens, 3, false, pattern, count, type))
+        return out.error(err);
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+    uint64_t next = db.hscan(tokens[1], cursor, count, pattern, pairs);
+    scanReply(out, next, pairs.size() * 2);
+    for (auto& pair : pairs) {
+        out.bulk(pair.first);
+        out.bulk(std::move(pair.second));
+    }
+}
+
+static void handleType(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    out.simple(db.type(tokens[1]));
+}
+
+//OBJECT ENCODING key -> only subcommand for now
+static void handleObject(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    if (!iequals(tokens[1], "encoding"))
+        return out.error("Error: unknown OBJECT subcommand");
+    std::string enc = db.encoding(tokens[2]);
+    if (enc.empty()) return out.null();
+    out.bulk(enc);
+}
+
+//MEMORY USAGE key -> estimated bytes of the entry, nil when missing
+static void handleMemory(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    if (!iequals(tokens[1], "usage"))
+        return out.error("Error: unknown MEMORY subcommand");
+    long long bytes = db.memoryUsage(tokens[2]);
+    if (bytes < 0) return out.null();
+    out.integer(bytes);
+}
+
+static void handleDel(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    int removed = 0;
+    for (size_t i = 1; i < tokens.size(); ++i) {
+        if (db.del(tokens[i])) removed++;
+    }
+    out.integer(removed);
+}
+
+//same reply as DEL, big values are freed off the shard lock
+static void handleUnlink(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    int removed = 0;
+    for (size_t i = 1; i < tokens.size(); ++i) {
+        if (db.unlink(tokens[i])) removed++;
     }
+    out.integer(removed);
+}
+
+static void handleExpire(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    int seconds;
+    if (!toInt(tokens[2], seconds))
+        return out.error("Error: Invalid expiration time");
+    int64_t when = db.expire(tokens[1], seconds);
+    if (!when)
+        return out.error("Error: Key not found");
+    //relative ttl would restart on every replay -> log the absolute deadline instead
+    if (AppendOnlyFile::active()) logAs = {"PEXPIREAT", std::string(tokens[1]), std::to_string(when)};
+    out.ok();
+}
+
+static void handlePexpireat(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    int64_t when;
+    if (!toInt(tokens[2], when))
+        return out.error("Error: Invalid expiration time");
+    out.integer(db.pexpireAt(tokens[1], when) ? 1 : 0);
 }
 
-static std::string handleRename(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 3)
-        return "-Error: RENAME requires old key and new key\r\n";
+//-2 missing key, -1 no expiry
+static void handleTtl(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    int64_t ms = db.pttl(tokens[1]);
+    if (ms < 0)
+        return out.integer(ms);
+    out.integer((ms + 500) / 1000); //round like redis
+}
+
+static void handlePttl(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    out.integer(db.pttl(tokens[1]));
+}
+
+static void handlePersist(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    out.integer(db.persist(tokens[1]) ? 1 : 0);
+}
+
+static void handleRename(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
     if (db.rename(tokens[1], tokens[2]))
-        return "+OK\r\n";
-    return "-Error: Key not found or rename failed\r\n";
+        return out.ok();
+    out.error("Error: Key not found or rename failed");
 }
 
 //-----
 //-----
 // list operations 
-static std::string handleLget(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2)
-        return "-Error: LGET requires a key\r\n";
-
-    auto elems = db.lget(tokens[1]);
-    std::ostringstream oss;
-    oss << "*" << elems.size() << "\r\n";
-    for (const auto& e : elems) {
-        oss << "$" << e.size() << "\r\n"
-            << e << "\r\n";
+//slice goes from the list straight into the output chunks, no intermediate vector or string
+static void rangeReply(Database& db, std::string_view key, long start, long stop, RespWriter& out) {
+    db.lrange(key, start, stop,
+        [&out](size_t n) { out.arrayHeader(n); },
+        [&out](std::string_view item) { out.bulk(item); });
+}
+
+static void handleLget(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    rangeReply(db, tokens[1], 0, -1, out);
+}
+
+static void handleLrange(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    long start, stop;
+    if (!toInt(tokens[2], start) || !toInt(tokens[3], stop))
+        return out.error("Error: Invalid index");
+    rangeReply(db, tokens[1], start, stop, out);
+}
+
+static void handleLtrim(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    long start, stop;
+    if (!toInt(tokens[2], start) || !toInt(tokens[3], stop))
+        return out.error("Error: Invalid index");
+    db.ltrim(tokens[1], start, stop);
+    out.ok();
+}
+
+//LINSERT key BEFORE|AFTER pivot element
+static void handleLinsert(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    bool after;
+    if (iequals(tokens[2], "after")) after = true;
+    else if (iequals(tokens[2], "before")) after = false;
+    else return out.error("Error: syntax error");
+    out.integer(db.linsert(tokens[1], after, tokens[3], tokens[4]));
+}
+
+//LPOS key element [RANK r] [COUNT n] [MAXLEN len] -> index / nil, an array with COUNT
+static void handleLpos(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    long rank = 1;
+    size_t count = 0, maxlen = 0;
+    bool withCount = false;
+    for (size_t i = 3; i < tokens.size(); i += 2) {
+        if (i + 1 >= tokens.size())
+            return out.error("Error: syntax error");
+        std::string_view arg = tokens[i + 1];
+        if (iequals(tokens[i], "rank")) {
+            if (!toInt(arg, rank) || rank == 0 || rank == LONG_MIN)
+                return out.error("Error: RANK must be a non zero integer");
+        } else if (iequals(tokens[i], "count")) {
+            if (!toInt(arg, count))
+                return out.error("Error: COUNT can't be negative");
+            withCount = true;
+        } else if (iequals(tokens[i], "maxlen")) {
+            if (!toInt(arg, maxlen))
+                return out.error("Error: MAXLEN can't be negative");
+        } else {
+            return out.error("Error: syntax error");
+        }
+    }
+
+    auto found = db.lpos(tokens[1], tokens[2], rank, withCount ? count : 1, maxlen);
+    if (!withCount) {
+        if (found.empty()) return out.null();
+        return out.integer(found[0]);
     }
-    return oss.str();
+    out.arrayHeader(found.size());
+    for (long idx : found) out.integer(idx);
 }
 
-static std::string handleLlen(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2) 
-        return "-Error: LLEN requires key\r\n";
-    ssize_t len = db.llen(tokens[1]);
-    return ":" + std::to_string(len) + "\r\n";
+static void handleLlen(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    out.integer(db.llen(tokens[1]));
 }
 
-static std::string handleLpush(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 3) 
-        return "-Error: LPUSH requires key and value\r\n";
+static void handleLpush(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
     for (size_t i = 2; i < tokens.size(); ++i) {
         db.lpush(tokens[1], tokens[i]);
     }
-    ssize_t len = db.llen(tokens[1]);
-    return ":" + std::to_string(len) + "\r\n";
+    out.integer(db.llen(tokens[1]));
 }
 
-static std::string handleRpush(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 3) 
-        return "-Error: RPUSH requires key and value\r\n";
+static void handleRpush(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
     for (size_t i = 2; i < tokens.size(); ++i) {
         db.rpush(tokens[1], tokens[i]);
     }    
-    ssize_t len = db.llen(tokens[1]);
-    return ":" + std::to_string(len) + "\r\n";
+    out.integer(db.llen(tokens[1]));
 }
 
-static std::string handleLpop(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2) 
-        return "-Error: LPOP requires key\r\n";
+static void handleLpop(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
     std::string val;
     if (db.lpop(tokens[1], val))
-        return "$" + std::to_string(val.size()) + "\r\n" + val + "\r\n";
-    return "$-1\r\n";
+        return out.bulk(std::move(val));
+    out.null();
 }
 
-static std::string handleRpop(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2) 
-        return "-Error: RPOP requires key\r\n";
+static void handleRpop(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
     std::string val;
     if (db.rpop(tokens[1], val))
-        return "$" + std::to_string(val.size()) + "\r\n" + val + "\r\n";
-    return "$-1\r\n";
+        return out.bulk(std::move(val));
+    out.null();
 }
 
-static std::string handleLrem(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 4) 
-        return "-Error: LREM requires key, count and value\r\n";
-    try {
-        int count = std::stoi(tokens[2]);
-        int removed = db.lrem(tokens[1], count, tokens[3]);
-        return ":" +std::to_string(removed) + "\r\n";
-    } catch (const std::exception&) {
-        return "-Error: Invalid count\r\n";
-    }
+static void handleLrem(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    int count;
+    if (!toInt(tokens[2], count))
+        return out.error("Error: Invalid count");
+    out.integer(db.lrem(tokens[1], count, tokens[3]));
 }
 
-static std::string handleLindex(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 3) 
-        return "-Error: LINDEX requires key and index\r\n";
-    try {
-        int index = std::stoi(tokens[2]);
-        std::string value;
-        if (db.lindex(tokens[1], index, value)) 
-            return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
-        else 
-            return "$-1\r\n";
-    } catch (const std::exception&) {
-        return "-Error: Invalid index\r\n";
-    }
+static void handleLindex(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    int index;
+    if (!toInt(tokens[2], index))
+        return out.error("Error: Invalid index");
+    std::string value;
+    if (db.lindex(tokens[1], index, value)) 
+        out.bulk(std::move(value));
+    else 
+        out.null();
 }
 
-static std::string handleLset(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 4) 
-        return "-Error: LEST requires key, index and value\r\n";
-    try {
-        int index = std::stoi(tokens[2]);
-        if (db.lset(tokens[1], index, tokens[3]))
-            return "+OK\r\n";
-        else 
-            return "-Error: Index out of range\r\n";
-    } catch (const std::exception&) {
-        return "-Error: Invalid index\r\n";
-    }
+static void handleLset(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    int index;
+    if (!toInt(tokens[2], index))
+        return out.error("Error: Invalid index");
+    if (db.lset(tokens[1], index, tokens[3]))
+        out.ok();
+    else 
+        out.error("Error: Index out of range");
 }
 
 
 //--
 //--
 //hash operations 
-static std::string handleHset(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 4) 
-        return "-Error: HSET requires key, field and value\r\n";
+static void handleHset(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
     db.hset(tokens[1], tokens[2], tokens[3]);
-    return ":1\r\n";
+    out.integer(1);
 }
 
-static std::string handleHget(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 3) 
-        return "-Error: HSET requires key and field\r\n";
+static void handleHget(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
     std::string value;
     if (db.hget(tokens[1], tokens[2], value))
-        return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
-    return "$-1\r\n";
+        return out.bulk(std::move(value));
+    out.null();
 }
 
-static std::string handleHexists(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 3) 
-        return "-Error: HEXISTS requires key and field\r\n";
-    bool exists = db.hexists(tokens[1], tokens[2]);
-    return ":" + std::to_string(exists ? 1 : 0) + "\r\n";
+static void handleHexists(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    out.integer(db.hexists(tokens[1], tokens[2]) ? 1 : 0);
 }
 
-static std::string handleHdel(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 3) 
-        return "-Error: HDEL requires key and field\r\n";
-    bool res = db.hdel(tokens[1], tokens[2]);
-    return ":" + std::to_string(res ? 1 : 0) + "\r\n";
+static void handleHdel(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    out.integer(db.hdel(tokens[1], tokens[2]) ? 1 : 0);
 }
 
-static std::string handleHgetall (const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2) 
-        return "-Error: HGETALL requires key\r\n";
-    auto hash = db.hgetall(tokens[1]);
-    std::ostringstream oss;
-    oss << "*" << hash.size() * 2 << "\r\n";
-    for (const auto& pair: hash) {
-        oss << "$" << pair.first.size() << "\r\n" << pair.first << "\r\n";
-        oss << "$" << pair.second.size() << "\r\n" << pair.second << "\r\n";
-    }
-    return oss.str();
+//pairs go from the hash straight into the output chunks
+static void handleHgetall (const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    db.hgetall(tokens[1],
+        [&out](size_t pairs) { out.arrayHeader(pairs * 2); },
+        [&out](std::string_view field, std::string_view value) {
+            out.bulk(field);
+            out.bulk(value);
+        });
 }
 
-static std::string handleHkeys(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2) 
-        return "-Error: HKEYS requires key\r\n";
-    auto keys = db.hkeys(tokens[1]);
-    std::ostringstream oss;
-    oss << "*" << keys.size() << "\r\n";
-    for (const auto& key: keys) {
-        oss << "$" << key.size() << "\r\n" << key << "\r\n";
-    }
-    return oss.str();
+static void handleHkeys(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    db.hgetall(tokens[1],
+        [&out](size_t pairs) { out.arrayHeader(pairs); },
+        [&out](std::string_view field, std::string_view) { out.bulk(field); });
 }
 
-static std::string handleHvals(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2) 
-        return "-Error: HVALS requires key\r\n";
-    auto values = db.hvals(tokens[1]);
-    std::ostringstream oss;
-    oss << "*" << values.size() << "\r\n";
-    for (const auto& val: values) {
-        oss << "$" << val.size() << "\r\n" << val << "\r\n";
-    }
-    return oss.str();
+static void handleHvals(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    db.hgetall(tokens[1],
+        [&out](size_t pairs) { out.arrayHeader(pairs); },
+        [&out](std::string_view, std::string_view value) { out.bulk(value); });
 }
 
-static std::string handleHlen(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 2) 
-        return "-Error: HLEN requires key\r\n";
-    ssize_t len = db.hlen(tokens[1]);
-    return ":" + std::to_string(len) + "\r\n";
+static void handleHlen(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    out.integer(db.hlen(tokens[1]));
 }
 
-static std::string handleHmset(const std::vector<std::string>& tokens, Database& db) {
-    if (tokens.size() < 4 || (tokens.size() % 2) == 1) 
-        return "-Error: HMSET requires key followed by field value pairs\r\n";
-    std::vector<std::pair<std::string, std::string>> fieldValues;
+static void handleHmset(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out) {
+    if ((tokens.size() % 2) == 1) 
+        return out.error("Error: HMSET requires key followed by field value pairs");
+    std::vector<std::pair<std::string_view, std::string_view>> fieldValues;
+    fieldValues.reserve((tokens.size() - 2) / 2);
     for (size_t i = 2; i < tokens.size(); i += 2) {
         fieldValues.emplace_back(tokens[i], tokens[i+1]);
     }
     db.hmset(tokens[1], fieldValues);
-    return "+OK\r\n";
+    out.ok();
+}
+
+static void handleCommand(const std::vector<std::string_view>& tokens, Database& db, RespWriter& out);
+
+//--
+//--
+//command table
+//arity -> exact token count (name included), negative -> at least -arity
+//first/last key position + step like redis COMMAND (last -1 -> up to the end)
+static constexpr CommandSpec commandTable[] = {
+    {"ping",     -1, CMD_FAST,                  0, 0, 0, handlePing},
+    {"echo",      2, CMD_FAST,                  0, 0, 0, handleEcho},
+    {"flushall", -1, CMD_WRITE,                 0, 0, 0, handleFlushAll},
+    {"info",     -1, CMD_ADMIN,                 0, 0, 0, handleInfo},
+    {"save",      1, CMD_ADMIN,                 0, 0, 0, handleSave},
+    {"bgsave",    1, CMD_ADMIN,                 0, 0, 0, handleBgsave},
+    {"bgrewriteaof", 1, CMD_ADMIN,              0, 0, 0, handleBgrewriteaof},
+    {"command",  -1, CMD_ADMIN,                 0, 0, 0, handleCommand},
+    {"latency",  -2, CMD_ADMIN,                 0, 0, 0, handleLatency},
+    {"slowlog",  -2, CMD_ADMIN,                 0, 0, 0, handleSlowlog},
+
+    {"set",       3, CMD_WRITE | CMD_DENYOOM,   1, 1, 1, handleSet},
+    {"get",       2, CMD_READONLY | CMD_FAST,   1, 1, 1, handleGet},
+    {"mget",     -2, CMD_READONLY | CMD_MULTIKEY, 1, -1, 1, handleMget},
+    {"mset",     -3, CMD_WRITE | CMD_MULTIKEY | CMD_DENYOOM, 1, -1, 2, handleMset},
+    {"msetnx",   -3, CMD_WRITE | CMD_MULTIKEY | CMD_DENYOOM, 1, -1, 2, handleMsetnx},
+    {"keys",     -1, CMD_READONLY,              0, 0, 0, handleKeys},
+    {"scan",     -2, CMD_READONLY,              0, 0, 0, handleScan},
+    {"type",      2, CMD_READONLY | CMD_FAST,   1, 1, 1, handleType},
+    {"object",    3, CMD_READONLY | CMD_FAST,   2, 2, 1, handleObject},
+    {"memory",    3, CMD_READONLY,              2, 2, 1, handleMemory},
+    {"del",      -2, CMD_WRITE | CMD_MULTIKEY,  1, -1, 1, handleDel},
+    {"unlink",   -2, CMD_WRITE | CMD_MULTIKEY,  1, -1, 1, handleUnlink},
+    {"expire",    3, CMD_WRITE | CMD_FAST,      1, 1, 1, handleExpire},
+    {"pexpireat", 3, CMD_WRITE | CMD_FAST,      1, 1, 1, handlePexpireat},
+    {"ttl",       2, CMD_READONLY | CMD_FAST,   1, 1, 1, handleTtl},
+    {"pttl",      2, CMD_READONLY | CMD_FAST,   1, 1, 1, handlePttl},
+    {"persist",   2, CMD_WRITE | CMD_FAST,      1, 1, 1, handlePersist},
+    {"rename",    3, CMD_WRITE | CMD_MULTIKEY,  1, 2, 1, handleRename},
+
+    {"lget",      2, CMD_READONLY,              1, 1, 1, handleLget},
+    {"llen",      2, CMD_READONLY | CMD_FAST,   1, 1, 1, handleLlen},
+    {"lpush",    -3, CMD_WRITE | CMD_FAST | CMD_DENYOOM, 1, 1, 1, handleLpush},
+    {"rpush",    -3, CMD_WRITE | CMD_FAST | CMD_DENYOOM, 1, 1, 1, handleRpush},
+    {"lpop",      2, CMD_WRITE | CMD_FAST,      1, 1, 1, handleLpop},
+    {"rpop",      2, CMD_WRITE | CMD_FAST,      1, 1, 1, handleRpop},
+    {"lrem",      4, CMD_WRITE,                 1, 1, 1, handleLrem},
+    {"lindex",    3, CMD_READONLY,              1, 1, 1, handleLindex},
+    {"lset",      4, CMD_WRITE | CMD_DENYOOM,   1, 1, 1, handleLset},
+    {"lrange",    4, CMD_READONLY,              1, 1, 1, handleLrange},
+    {"ltrim",     4, CMD_WRITE,                 1, 1, 1, handleLtrim},
+    {"linsert",   5, CMD_WRITE | CMD_DENYOOM,   1, 1, 1, handleLinsert},
+    {"lpos",     -3, CMD_READONLY,              1, 1, 1, handleLpos},
+
+    {"hset",      4, CMD_WRITE | CMD_FAST | CMD_DENYOOM, 1, 1, 1, handleHset},
+    {"hget",      3, CMD_READONLY | CMD_FAST,   1, 1, 1, handleHget},
+    {"hexists",   3, CMD_READONLY | CMD_FAST,   1, 1, 1, handleHexists},
+    {"hdel",      3, CMD_WRITE | CMD_FAST,      1, 1, 1, handleHdel},
+    {"hgetall",   2, CMD_READONLY,              1, 1, 1, handleHgetall},
+    {"hkeys",     2, CMD_READONLY,              1, 1, 1, handleHkeys},
+    {"hvals",     2, CMD_READONLY,              1, 1, 1, handleHvals},
+    {"hlen",      2, CMD_READONLY | CMD_FAST,   1, 1, 1, handleHlen},
+    {"hscan",    -3, CMD_READONLY,              1, 1, 1, handleHscan},
+    {"hmset",    -4, CMD_WRITE | CMD_DENYOOM,   1, 1, 1, handleHmset},
+};
+
+static constexpr size_t COMMAND_COUNT = sizeof(commandTable) / sizeof(commandTable[0]);
+static_assert(COMMAND_COUNT < 255, "slot index is a uint8_t");
+
+//perfect hash over case folded names, searched at compile time
+//lookup = one hash + one slot + one compare, nothing allocated
+static constexpr size_t DISPATCH_SLOTS = 1024; //power of two, ~10x the command count keeps the seed search short
+static constexpr uint8_t EMPTY_SLOT = 0xFF;
+
+static constexpr uint32_t hashCommandName(std::string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u); //fnv-1a, seed mixed into the offset basis
+    for (char c : name) {
+        unsigned char ch = static_cast<unsigned char>(c);
+        if (ch >= 'A' && ch <= 'Z') ch |= 0x20; //fold case while hashing
+        h ^= ch;
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+struct DispatchIndex {
+    uint32_t seed;
+    std::array<uint8_t, DISPATCH_SLOTS> slots;
+};
+
+static constexpr DispatchIndex buildDispatchIndex() {
+    for (uint32_t seed = 0; seed < 100000; seed++) {
+        DispatchIndex index{seed, {}};
+        for (auto& slot : index.slots) slot = EMPTY_SLOT;
+        bool collision = false;
+        for (size_t i = 0; i < COMMAND_COUNT && !collision; i++) {
+            size_t slot = hashCommandName(commandTable[i].name, seed) & (DISPATCH_SLOTS - 1);
+            if (index.slots[slot] != EMPTY_SLOT) collision = true;
+            else index.slots[slot] = static_cast<uint8_t>(i);
+        }
+        if (!collision) return index;
+    }
+    return DispatchIndex{UINT32_MAX, {}};
+}
+
+static constexpr DispatchIndex dispatchIndex = buildDispatchIndex();
+static_assert(dispatchIndex.seed != UINT32_MAX, "no perfect hash seed found, grow DISPATCH_SLOTS");
+
+const CommandSpec* lookupCommand(std::string_view name) {
+    size_t slot = hashCommandName(name, dispatchIndex.seed) & (DISPATCH_SLOTS - 1);
+    uint8_t idx = dispatchIndex.slots[slot];
+    if (idx == EMPTY_SLOT) return nullptr;
+    const CommandSpec& spec = commandTable[idx];
+    return iequals(name, spec.name) ? &spec : nullptr;
+}
+
+size_t commandCount() {
+    return COMMAND_COUNT;
+}
+
+const CommandSpec& commandAt(size_t index) {
+    return commandTable[index];
+}
+
+//one COMMAND entry -> [name, arity, [flags], first key, last key, step]
+static void appendCommandInfo(RespWriter& out, const CommandSpec& spec) {
+    static const std::pair<uint32_t, const char*> flagNames[] = {
+        {CMD_READONLY, "readonly"}, {CMD_WRITE, "write"}, {CMD_MULTIKEY, "multikey"},
+        {CMD_ADMIN, "admin"}, {CMD_FAST, "fast"}, {CMD_DENYOOM, "denyoom"},
+    };
+    out.arrayHeader(6);
+    out.bulk(spec.name);
+    out.integer(spec.arity);
+    size_t flagCount = 0;
+    for (const auto& flag : flagNames)
+        if (spec.flags & flag.first) flagCount++;
+    out.arrayHeader(flagCount);
+    for (const auto& flag : flagNames)
+        if (spec.flags & flag.first) out.simple(flag.second);
+    out.integer(spec.first_key);
+    out.integer(spec.last_key);
+    out.integer(spec.key_step);
+}
+
+//COMMAND, COMMAND COUNT, COMMAND INFO name [name ...]
+static void handleCommand(const std::vector<std::string_view>& tokens, Database& /*db*/, RespWriter& out) {
+    if (tokens.size() == 1) {
+        out.arrayHeader(COMMAND_COUNT);
+        for (const auto& spec : commandTable)
+            appendCommandInfo(out, spec);
+        return;
+    }
+    if (iequals(tokens[1], "count"))
+        return out.integer(COMMAND_COUNT);
+    if (iequals(tokens[1], "info")) {
+        out.arrayHeader(tokens.size() - 2);
+        for (size_t i = 2; i < tokens.size(); ++i) {
+            const CommandSpec* spec = lookupCommand(tokens[i]);
+            if (spec) appendCommandInfo(out, *spec);
+            else out.nullArray();
+        }
+        return;
+    }
+    out.error("Error: Unknown COMMAND subcommand");
 }
 
 CommandHandler::CommandHandler() {}
 
-std::string CommandHandler::processCommand(const std::string& commandLine) {
-    // RESP parser use here
-    auto tokens = parseRespCommand(commandLine);
-    if (tokens.empty()) return "-Error: Empty command\r\n";
-
-    std::string cmd = tokens[0];
-    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
-    Database& db = Database::getInstance();
-
-    
-    if (cmd == "PING")
-        return handlePing(tokens, db);
-    else if (cmd == "ECHO")
-        return handleEcho(tokens, db);
-    else if (cmd == "FLUSHALL")
-        return handleFlushAll(tokens, db);
-    
-    else if (cmd == "SET")
-        return handleSet(tokens, db);
-    else if (cmd == "GET")
-        return handleGet(tokens, db);
-    else if (cmd == "KEYS")
-        return handleKeys(tokens, db);
-    else if (cmd == "TYPE")
-        return handleType(tokens, db);
-    else if (cmd == "DEL" || cmd == "UNLINK")
-        return handleDel(tokens, db);
-    else if (cmd == "EXPIRE")
-        return handleExpire(tokens, db);
-    else if (cmd == "RENAME")
-        return handleRename(tokens, db);
-   
-    else if (cmd == "LGET") 
-        return handleLget(tokens, db);
-    else if (cmd == "LLEN") 
-        return handleLlen(tokens, db);
-    else if (cmd == "LPUSH")
-        return handleLpush(tokens, db);
-    else if (cmd == "RPUSH")
-        return handleRpush(tokens, db);
-    else if (cmd == "LPOP")
-        return handleLpop(tokens, db);
-    else if (cmd == "RPOP")
-        return handleRpop(tokens, db);
-    else if (cmd == "LREM")
-        return handleLrem(tokens, db);
-    else if (cmd == "LINDEX")
-        return handleLindex(tokens, db);
-    else if (cmd == "LSET")
-        return handleLset(tokens, db);
-    
-    else if (cmd == "HSET") 
-        return handleHset(tokens, db);
-    else if (cmd == "HGET") 
-        return handleHget(tokens, db);
-    else if (cmd == "HEXISTS") 
-        return handleHexists(tokens, db);
-    else if (cmd == "HDEL") 
-        return handleHdel(tokens, db);
-    else if (cmd == "HGETALL") 
-        return handleHgetall(tokens, db);
-    else if (cmd == "HKEYS") 
-        return handleHkeys(tokens, db);
-    else if (cmd == "HVALS") 
-        return handleHvals(tokens, db);
-    else if (cmd == "HLEN") 
-        return handleHlen(tokens, db);
-    else if (cmd == "HMSET") 
-        return handleHmset(tokens, db);
-    else 
-        return "-Error: Unknown command\r\n";
-}
\ No newline at end of file
+//evicts until used memory is back under maxmemory, false -> over it with nothing left to evict
+//every victim is logged as a DEL under its ordering lock -> a replay ends with the same keyspace
+static bool performEvictions(Database& db) {
+    static const CommandSpec* delSpec = lookupCommand("del");
+    AppendOnlyFile* aof = AppendOnlyFile::active();
+    std::string victim;
+    while (db.overMaxmemory()) {
+        if (!db.evictionCandidate(victim)) return false;
+        if (!aof) {
+            db.evictKey(victim);
+            continue;
+        }
+        const std::vector<std::string_view> args = {"del", victim};
+        auto order = aof->lockKeys(*delSpec, args);
+        if (db.evictKey(victim)) aof->feed(args);
+    }
+    return true;
+}
+
+void CommandHandler::processCommand(const std::vector<std::string_view>& tokens, RespWriter& out, std::string_view client) {
+    if (tokens.empty()) return out.error("Error: Empty command");
+
+    ThreadStats& stats = threadStats();
+    const CommandSpec* spec = lookupCommand(tokens[0]);
+    if (!spec) {
+        stats.unknown_commands.add(1);
+        return out.error("Error: Unknown command");
+    }
+    CommandStats& cmdStats = stats.commands[spec - commandTable];
+
+    //generic arity check driven by the table
+    int argc = static_cast<int>(tokens.size());
+    if ((spec->arity > 0 && argc != spec->arity) || (spec->arity < 0 && argc < -spec->arity)) {
+        cmdStats.rejected.add(1);
+        std::string message = "Error: wrong number of arguments for '";
+        message.append(spec->name).append("' command");
+        return out.error(message);
+    }
+
+    if ((spec->flags & CMD_DENYOOM) && !performEvictions(Database::getInstance())) {
+        cmdStats.rejected.add(1);
+        return out.error("OOM command not allowed when used memory > 'maxmemory'");
+    }
+
+    AppendOnlyFile* aof = AppendOnlyFile::active();
+    if (aof && (spec->flags & CMD_WRITE) && aof->writeFailed()) {
+        cmdStats.rejected.add(1);
+        return out.error("MISCONF Errors writing to the AOF file, write commands are disabled until it works again");
+    }
+
+    //timed from here -> lock waits + execution + aof feed, not parsing or the send
+    size_t errors = out.errors();
+    size_t replyStart = out.size();
+    auto start = std::chrono::steady_clock::now();
+    try {
+        if (aof && (spec->flags & CMD_WRITE)) {
+            //execute + log under the key's ordering lock, failed writes (error reply) are not logged
+            auto order = aof->lockKeys(*spec, tokens);
+            logAs.clear();
+            spec->handler(tokens, Database::getInstance(), out);
+            if (out.errors() == errors && logAs.empty()) {
+                aof->feed(tokens);
+            } else if (out.errors() == errors) {
+                const std::vector<std::string_view> args(logAs.begin(), logAs.end());
+                aof->feed(args);
+            }
+        } else {
+            spec->handler(tokens, Database::getInstance(), out);
+        }
+    } catch (const WrongTypeError& e) {
+        //thrown by the key lookup, before the handler wrote anything
+        out.error(e.what());
+    } catch (const std::exception& e) {
+        //bad_alloc, length_error, out_of_range... -> fail this command, not the reactor thread
+        //a half written reply is dropped so the client still gets exactly one
+        out.rollback(replyStart);
+        out.error(std::string("Error: command failed: ") + e.what());
+    }
+    uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    cmdStats.calls.add(1);
+    cmdStats.ns.add(ns);
+    cmdStats.latency[LatencyBuckets::of(ns)].add(1);
+    if (out.errors() != errors) cmdStats.failed.add(1);
+    Slowlog& slowlog = Slowlog::instance();
+    if (slowlog.isSlow(ns / 1000)) slowlog.record(tokens, ns / 1000, client);
+}
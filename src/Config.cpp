@@ -0,0 +1,130 @@
+#include "../include/Config.h"
+
+#include <iostream>
+#include <exception>
+#include <cctype>
+
+std::string usage() {
+    return "usage: vertex [port] [--port N] [--reactors N] [--shards N]\n"
+           "              [--list-max-listpack-entries N] [--list-max-listpack-value N]\n"
+           "              [--hash-max-listpack-entries N] [--hash-max-listpack-value N]\n"
+           "              [--appendonly yes|no] [--appendfsync always|everysec|no]\n"
+           "              [--maxmemory bytes[kb|mb|gb]] [--maxmemory-policy noeviction|allkeys-lru|\n"
+           "               allkeys-lfu|volatile-lru|volatile-ttl] [--maxmemory-samples N]\n"
+           "              [--slowlog-log-slower-than usec] [--slowlog-max-len N]\n"
+           "              [--client-query-buffer-limit bytes[kb|mb|gb]]\n"
+           "              [--client-output-buffer-limit bytes[kb|mb|gb]]\n";
+}
+
+//stoi with a readable error instead of an uncaught exception
+static bool parseInt(const std::string& name, const std::string& text, int min, int& out) {
+    try {
+        size_t used = 0;
+        int value = std::stoi(text, &used);
+        if (used != text.size() || value < min) throw std::invalid_argument(text);
+        out = value;
+        return true;
+    } catch (const std::exception&) {
+        std::cerr << "invalid value for " << name << ": " << text << "\n";
+        return false;
+    }
+}
+
+//byte count with an optional kb/mb/gb suffix (1024 based, case insensitive), like redis maxmemory
+static bool parseBytes(const std::string& name, const std::string& text, size_t& out) {
+    size_t digits = 0;
+    while (digits < text.size() && text[digits] >= '0' && text[digits] <= '9') digits++;
+    std::string unit = text.substr(digits);
+    for (char& c : unit) c = static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+    size_t scale = unit.empty() || unit == "b" ? 1 : unit == "kb" ? 1024 : unit == "mb" ? 1024 * 1024
+                 : unit == "gb" ? size_t(1024) * 1024 * 1024 : 0;
+    try {
+        if (digits == 0 || scale == 0) throw std::invalid_argument(text);
+        out = static_cast<size_t>(std::stoull(text.substr(0, digits))) * scale;
+        return true;
+    } catch (const std::exception&) {
+        std::cerr << "invalid value for " << name << ": " << text << "\n";
+        return false;
+    }
+}
+
+bool parseArgs(int argc, char* argv[], Config& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        //old style -> bare port number as first arg
+        if (arg.rfind("--", 0) != 0) {
+            if (i != 1) {
+                std::cerr << "unexpected argument: " << arg << "\n";
+                return false;
+            }
+            if (!parseInt("port", arg, 1, config.port)) return false;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << arg << "\n";
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--port") {
+            if (!parseInt(arg, value, 1, config.port)) return false;
+        } else if (arg == "--reactors") {
+            if (!parseInt(arg, value, 1, config.reactors)) return false;
+        } else if (arg == "--shards") {
+            if (!parseInt(arg, value, 1, config.shards)) return false;
+            if ((config.shards & (config.shards - 1)) != 0) {
+                std::cerr << "--shards must be a power of two\n";
+                return false;
+            }
+        } else if (arg == "--list-max-listpack-entries") {
+            if (!parseInt(arg, value, 0, config.list_max_listpack_entries)) return false;
+        } else if (arg == "--list-max-listpack-value") {
+            if (!parseInt(arg, value, 0, config.list_max_listpack_value)) return false;
+        } else if (arg == "--hash-max-listpack-entries") {
+            if (!parseInt(arg, value, 0, config.hash_max_listpack_entries)) return false;
+        } else if (arg == "--hash-max-listpack-value") {
+            if (!parseInt(arg, value, 0, config.hash_max_listpack_value)) return false;
+        } else if (arg == "--appendonly") {
+            if (value != "yes" && value != "no") {
+                std::cerr << "--appendonly must be yes or no\n";
+                return false;
+            }
+            config.appendonly = value == "yes";
+        } else if (arg == "--appendfsync") {
+            if (value != "always" && value != "everysec" && value != "no") {
+                std::cerr << "--appendfsync must be always, everysec or no\n";
+                return false;
+            }
+            config.appendfsync = value;
+        } else if (arg == "--maxmemory") {
+            if (!parseBytes(arg, value, config.maxmemory)) return false;
+        } else if (arg == "--maxmemory-policy") {
+            if (value != "noeviction" && value != "allkeys-lru" && value != "allkeys-lfu" &&
+                value != "volatile-lru" && value != "volatile-ttl") {
+                std::cerr << "--maxmemory-policy must be noeviction, allkeys-lru, allkeys-lfu, volatile-lru or volatile-ttl\n";
+                return false;
+            }
+            config.maxmemory_policy = value;
+        } else if (arg == "--maxmemory-samples") {
+            if (!parseInt(arg, value, 1, config.maxmemory_samples)) return false;
+        } else if (arg == "--slowlog-log-slower-than") {
+            if (!parseInt(arg, value, -1, config.slowlog_log_slower_than)) return false;
+        } else if (arg == "--slowlog-max-len") {
+            if (!parseInt(arg, value, 0, config.slowlog_max_len)) return false;
+        } else if (arg == "--client-query-buffer-limit") {
+            if (!parseBytes(arg, value, config.client_query_buffer_limit)) return false;
+            if (config.client_query_buffer_limit < 1024 * 1024) {
+                std::cerr << "--client-query-buffer-limit must be at least 1mb\n";
+                return false;
+            }
+        } else if (arg == "--client-output-buffer-limit") {
+            if (!parseBytes(arg, value, config.client_output_buffer_limit)) return false;
+        } else {
+            std::cerr << "unknown option: " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+#include "../include/Crc64.h"
+
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t POLY = 0x95ac9329ac4bc9b5ULL; //0xad93d23594c935a9 bit reversed
+
+//table[k][b] -> crc of byte b followed by k zero bytes
+constexpr std::array<std::array<uint64_t, 256>, 8> makeTables() {
+    std::array<std::array<uint64_t, 256>, 8> t{};
+    for (uint64_t b = 0; b < 256; b++) {
+        uint64_t crc = b;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ POLY : crc >> 1;
+        t[0][b] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int b = 0; b < 256; b++)
+            t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+    }
+    return t;
+}
+
+constexpr auto tables = makeTables();
+
+}
+
+uint64_t crc64(uint64_t crc, const void* data, size_t len) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8); //little endian host assumed (x86/arm linux)
+        crc ^= word;
+        crc = tables[7][crc & 0xFF] ^ tables[6][(crc >> 8) & 0xFF] ^
+              tables[5][(crc >> 16) & 0xFF] ^ tables[4][(crc >> 24) & 0xFF] ^
+              tables[3][(crc >> 32) & 0xFF] ^ tables[2][(crc >> 40) & 0xFF] ^
+              tables[1][(crc >> 48) & 0xFF] ^ tables[0][crc >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = tables[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
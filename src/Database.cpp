@@ -1,9 +1,32 @@
 #include "../include/Database.h"
+#include "../include/Glob.h"
+#include "../include/Stats.h"
+#include "../include/LazyFree.h"
 
-#include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <iterator>
+#include <type_traits>
+#include <cstdint>
+
+//contended acquires only -> the wait is what the thread spent blocked on another shard holder
+static void recordLockWait(std::chrono::steady_clock::time_point start) {
+    ThreadStats& stats = threadStats();
+    stats.lock_waits.add(1);
+    stats.lock_wait_ns.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+void ShardMutex::lockSlow() {
+    auto start = std::chrono::steady_clock::now();
+    mutex.lock();
+    recordLockWait(start);
+}
+
+void ShardMutex::lockSharedSlow() {
+    auto start = std::chrono::steady_clock::now();
+    mutex.lock_shared();
+    recordLockWait(start);
+}
 
 // get the instance {singleton}
 Database& Database::getInstance() {
@@ -11,165 +34,597 @@ Database& Database::getInstance() {
     return instance;
 }
 
+Database::Database() {
+    configureShards(DEFAULT_SHARDS);
+}
+
+//only meant for startup (before load / serving), existing data is dropped
+bool Database::configureShards(size_t count) {
+    if (count == 0 || (count & (count - 1)) != 0) return false; //power of two only -> mask instead of modulo
+    shards.clear();
+    for (size_t i = 0; i < count; i++)
+        shards.push_back(std::make_unique<Shard>());
+    shard_bits = 0;
+    while ((size_t(1) << shard_bits) < count) shard_bits++;
+    return true;
+}
+
+size_t Database::shardIndex(std::string_view key) const {
+    if (shard_bits == 0) return 0;
+    //fibonacci hashing -> top bits, the maps inside a shard keep using the low bits of the same hash
+    uint64_t h = StringHash{}(key);
+    return (h * 0x9E3779B97F4A7C15ull) >> (64 - shard_bits);
+}
+
+Database::Shard& Database::shardFor(std::string_view key) {
+    return *shards[shardIndex(key)];
+}
+
+//lock ordering rule: shards are always locked in ascending index order
+//and a shard lock is never held while asking for a lower one -> no deadlocks between multi shard ops
+std::vector<std::unique_lock<ShardMutex>> Database::lockAllExclusive() {
+    std::vector<std::unique_lock<ShardMutex>> locks;
+    locks.reserve(shards.size());
+    for (auto& shard : shards)
+        locks.emplace_back(shard->mutex);
+    return locks;
+}
+
+std::vector<std::shared_lock<ShardMutex>> Database::lockAllShared() {
+    std::vector<std::shared_lock<ShardMutex>> locks;
+    locks.reserve(shards.size());
+    for (auto& shard : shards)
+        locks.emplace_back(shard->mutex);
+    return locks;
+}
+
+template <typename Keys, typename KeyOf>
+std::vector<size_t> Database::shardsOf(const Keys& keys, KeyOf keyOf) const {
+    std::vector<size_t> idx;
+    idx.reserve(keys.size());
+    for (const auto& item : keys) idx.push_back(shardIndex(keyOf(item)));
+    std::sort(idx.begin(), idx.end());
+    idx.erase(std::unique(idx.begin(), idx.end()), idx.end());
+    return idx;
+}
+
+std::vector<std::unique_lock<ShardMutex>> Database::lockShardsExclusive(const std::vector<size_t>& idx) {
+    std::vector<std::unique_lock<ShardMutex>> locks;
+    locks.reserve(idx.size());
+    for (size_t i : idx)
+        locks.emplace_back(shards[i]->mutex);
+    return locks;
+}
+
+std::vector<std::shared_lock<ShardMutex>> Database::lockShardsShared(const std::vector<size_t>& idx) {
+    std::vector<std::shared_lock<ShardMutex>> locks;
+    locks.reserve(idx.size());
+    for (size_t i : idx)
+        locks.emplace_back(shards[i]->mutex);
+    return locks;
+}
+
 // Common Comands
-bool Database::flushAll() {
-    std::lock_guard<std::mutex> lock(db_mutex); //get the mutex {thread safety} auto release when fxn exit RAII TYPE
-    //clear the maps
-    kv_store.clear();
-    list_store.clear();
-    hash_store.clear();
+bool Database::flushAll(bool async) {
+    auto locks = lockAllExclusive(); //every shard, ascending order, released when locks goes out of scope
+    //clear the dictionaries
+    for (auto& shard : shards) {
+        if (async) {
+            //swapped out whole, the shard is usable again right away
+            size_t keys = shard->dict.size();
+            LazyFree::instance().disposeAll(std::make_pair(std::move(shard->dict), std::move(shard->expires)), keys);
+        }
+        shard->dict.clear();
+        shard->expires.clear();
+        shard->volatile_keys = 0;
+        shard->used_memory.store(0, std::memory_order_relaxed);
+    }
 
     //return success
     return true;
 }
 
+//read lookup, caller holds the shard lock shared
+//expired -> looks missing, wrong type -> WrongTypeError
+const Value* Database::lookupRead(Shard& shard, std::string_view key, ValueType type) {
+    auto it = shard.dict.find(key);
+    if (it == shard.dict.end() || it->second.isExpired(nowMs()))
+        return nullptr;
+    if (it->second.type != type)
+        throw WrongTypeError();
+    touch(it->second);
+    return &it->second;
+}
+
+//write lookup, caller holds the shard lock exclusively -> lazy expiry happens here
+Value* Database::lookupWrite(Shard& shard, std::string_view key) {
+    auto it = shard.dict.find(key);
+    if (it == shard.dict.end())
+        return nullptr;
+    if (it->second.isExpired(nowMs())) {
+        eraseEntry(shard, it); //its heap entry goes stale, dropped when popped
+        expiry_stats.expired_keys.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    touch(it->second);
+    return &it->second;
+}
+
+Value* Database::lookupWrite(Shard& shard, std::string_view key, ValueType type) {
+    Value* value = lookupWrite(shard, key);
+    if (value && value->type != type)
+        throw WrongTypeError();
+    return value;
+}
+
+Value& Database::lookupOrCreate(Shard& shard, std::string_view key, ValueType type) {
+    Value* value = lookupWrite(shard, key, type);
+    if (value) return *value;
+    Value fresh = (type == ValueType::List) ? Value::makeList() : Value::makeHash();
+    return insertEntry(shard, key, std::move(fresh));
+}
+
+template <typename F>
+auto Database::mutate(Shard& shard, Value& value, F&& fn) {
+    size_t before = value.memoryUsage(); //O(1) for every encoding
+    bool hadExpire = value.hasExpire();
+    auto settle = [&]() {
+        charge(shard, value.memoryUsage(), before);
+        shard.volatile_keys = shard.volatile_keys + value.hasExpire() - hadExpire;
+    };
+    if constexpr (std::is_void_v<std::invoke_result_t<F, Value&>>) {
+        fn(value);
+        settle();
+    } else {
+        auto result = fn(value);
+        settle();
+        return result;
+    }
+}
+
 // key value ops 
-void Database::set(const std::string& key, const std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex); //RAII auto release {get the lock}
-    kv_store[key] = value; 
-}
-
-bool Database::get(const std::string& key, std::string& value) {
-    //store retrieved value at &value ref
-    std::lock_guard<std::mutex> lock(db_mutex); //get lock
-    purgeExpired(); //remove expired keys 
-    auto it = kv_store.find(key); //search in map
-    if (it != kv_store.end()) {
-        value = it->second; //put value at &value
+//big values are copied into their shared buffer before any lock is taken
+static SharedString shareIfBig(std::string_view value) {
+    return value.size() >= Value::SHARED_MIN ? std::make_shared<const std::string>(value) : nullptr;
+}
+
+//SET replaces whatever the key held before (any type) and drops its expiry
+void Database::set(std::string_view key, std::string_view value) {
+    SharedString big = shareIfBig(value);
+    std::optional<Value> old; //declared before the lock -> the replaced value is freed after unlocking
+    Shard& shard = shardFor(key);
+    {
+        std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+        old = setLocked(shard, key, value, std::move(big));
+    }
+    if (old) LazyFree::instance().dispose(std::move(*old));
+}
+
+//big != nullptr -> value is stored as that shared buffer
+//returns the value it replaced (nullopt -> new key or string rewritten in place), moved out in O(1)
+//a big value is never written in place: readers holding the old buffer keep their bytes
+std::optional<Value> Database::setLocked(Shard& shard, std::string_view key, std::string_view value, SharedString big) {
+    auto it = shard.dict.find(key);
+    if (it == shard.dict.end()) {
+        insertEntry(shard, key, big ? Value::makeString(std::move(big)) : Value::makeString(value));
+        return std::nullopt;
+    }
+    Value& current = it->second;
+    touch(current); //an overwrite is an access, the key keeps its eviction clock
+    return mutate(shard, current, [&](Value& v) -> std::optional<Value> {
+        if (!big && v.type == ValueType::String && !v.isShared()) {
+            std::get<std::string>(v.data).assign(value.data(), value.size()); //reuse existing buffer
+            v.expire_at = Value::NO_EXPIRE;
+            return std::nullopt;
+        }
+        std::optional<Value> old(std::move(v));
+        v = big ? Value::makeString(std::move(big)) : Value::makeString(value);
+        v.lru = old->lru;
+        return old;
+    });
+}
+
+//small values are copied, big ones only gain a reference -> the lock is held for a refcount bump
+bool Database::get(std::string_view key, StringRef& value) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    const Value* v = lookupRead(shard, key, ValueType::String);
+    if (v) {
+        v->strRead(value);
         return true;//success
     }
-    return false;//not found pointer reached at map.end()
+    return false;//not found or expired
 }
 
-//retreive all keys from keyvalue, list and hash maps
-//gpt said raii lock good -> auto release when obj goes out of scope so be it
-std::vector<std::string> Database::keys() {
-    std::lock_guard<std::mutex> lock(db_mutex); //get the lock
-    purgeExpired(); //expired keys out
-    std::vector<std::string> result; 
+//whole batch under one shared lock per shard involved, taken together -> consistent view
+std::vector<std::optional<StringRef>> Database::mget(const std::vector<std::string_view>& keys) {
+    auto locks = lockShardsShared(shardsOf(keys, [](std::string_view k) { return k; }));
+    int64_t now = nowMs();
+    std::vector<std::optional<StringRef>> values(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        const Dict<Value>& dict = shardFor(keys[i]).dict;
+        auto it = dict.find(keys[i]);
+        //wrong type is nil here, not WRONGTYPE (same as redis)
+        if (it == dict.end() || it->second.isExpired(now) || it->second.type != ValueType::String)
+            continue;
+        touch(it->second);
+        it->second.strRead(values[i].emplace());
+    }
+    return values;
+}
 
-    //iterate and store in result var
-    for (const auto& pair : kv_store) {
-        result.push_back(pair.first);
+//pairs applied in order -> a repeated key ends with its last value
+void Database::mset(const std::vector<std::pair<std::string_view, std::string_view>>& pairs) {
+    std::vector<SharedString> big;
+    std::vector<Value> old; //replaced values, freed after unlocking
+    big.reserve(pairs.size());
+    for (const auto& pair : pairs) big.push_back(shareIfBig(pair.second));
+    {
+        auto locks = lockShardsExclusive(shardsOf(pairs, [](const auto& p) { return p.first; }));
+        for (size_t i = 0; i < pairs.size(); i++) {
+            if (auto prev = setLocked(shardFor(pairs[i].first), pairs[i].first, pairs[i].second, std::move(big[i])))
+                old.push_back(std::move(*prev));
+        }
     }
-    for (const auto& pair : list_store) {
-        result.push_back(pair.first);
+    for (auto& value : old) LazyFree::instance().dispose(std::move(value));
+}
+
+//all or nothing: one live key already there -> nothing is set
+bool Database::msetnx(const std::vector<std::pair<std::string_view, std::string_view>>& pairs) {
+    std::vector<SharedString> big;
+    std::vector<Value> old; //only a key repeated in the batch replaces anything, freed after unlocking
+    big.reserve(pairs.size());
+    for (const auto& pair : pairs) big.push_back(shareIfBig(pair.second));
+    {
+        auto locks = lockShardsExclusive(shardsOf(pairs, [](const auto& p) { return p.first; }));
+        for (const auto& pair : pairs) {
+            if (lookupWrite(shardFor(pair.first), pair.first)) return false;
+        }
+        for (size_t i = 0; i < pairs.size(); i++) {
+            if (auto prev = setLocked(shardFor(pairs[i].first), pairs[i].first, pairs[i].second, std::move(big[i])))
+                old.push_back(std::move(*prev));
+        }
     }
-    for (const auto& pair : hash_store) {
-        result.push_back(pair.first);
+    for (auto& value : old) LazyFree::instance().dispose(std::move(value));
+    return true;
+}
+
+//retreive the keys matching pattern
+//one shard at a time in ascending order -> other shards stay writable meanwhile
+std::vector<std::string> Database::keys(std::string_view pattern) {
+    std::vector<std::string> result; 
+
+    //no wildcard -> the key itself or nothing
+    if (!isGlobPattern(pattern)) {
+        Shard& shard = shardFor(pattern);
+        std::shared_lock<ShardMutex> lock(shard.mutex);
+        auto it = shard.dict.find(pattern);
+        if (it != shard.dict.end() && !it->second.isExpired(nowMs())) result.push_back(it->first);
+        return result;
+    }
+
+    bool all = pattern == "*";
+    for (auto& shardPtr : shards) {
+        Shard& shard = *shardPtr;
+        std::shared_lock<ShardMutex> lock(shard.mutex); //get the lock
+        int64_t now = nowMs();
+
+        //iterate and keep only the matches, expired keys skipped
+        for (const auto& pair : shard.dict) {
+            if (!pair.second.isExpired(now) && (all || globMatch(pattern, pair.first)))
+                result.push_back(pair.first);
+        }
     }
 
     //return result
     return result;
 }
 
+uint64_t Database::scan(uint64_t cursor, size_t count, std::string_view pattern,
+                        std::optional<ValueType> type, std::vector<std::string>& out) {
+    size_t shardIdx = cursor & (shards.size() - 1);
+    size_t bucket = cursor >> shard_bits;
+    bool all = pattern.empty() || pattern == "*";
+    size_t visited = 0;
+    size_t steps = 0, maxSteps = count * 10; //bounds the work on sparse tables too
+
+    while (visited < count && steps < maxSteps) {
+        Shard& shard = *shards[shardIdx];
+        {
+            std::shared_lock<ShardMutex> lock(shard.mutex);
+            int64_t now = nowMs();
+            do {
+                bucket = shard.dict.scan(bucket, [&](const std::string& key, const Value& value) {
+                    visited++;
+                    if (value.isExpired(now) || (type && value.type != *type)) return;
+                    if (all || globMatch(pattern, key)) out.push_back(key);
+                });
+                steps++;
+            } while (bucket != 0 && visited < count && steps < maxSteps);
+        }
+        //shard done -> next one starts at bucket 0, last one done -> whole scan done
+        if (bucket == 0 && ++shardIdx == shards.size()) return 0;
+    }
+    return (static_cast<uint64_t>(bucket) << shard_bits) | shardIdx;
+}
 
-//get the type of key->string, list or hash
-std::string Database::type(const std::string& key) {
-    std::lock_guard<std::mutex> lock(db_mutex); //lock :thread safety 
-    purgeExpired();
 
-    //check in which db will find key 
-    if (kv_store.find(key) != kv_store.end()) 
-        return "string";
-    if (list_store.find(key) != list_store.end())
-        return "list";
-    if (hash_store.find(key) != hash_store.end()) 
-        return "hash";
+//get the type of key->string, list or hash
+std::string Database::type(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    auto it = shard.dict.find(key);
+    if (it == shard.dict.end() || it->second.isExpired(nowMs()))
+        return "none"; //not found anywhere
+    return typeName(it->second.type);
+}
 
-    //not found anywhere 
-    else return "none";    
+//internal encoding, for OBJECT ENCODING
+std::string Database::encoding(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    auto it = shard.dict.find(key);
+    if (it == shard.dict.end() || it->second.isExpired(nowMs()))
+        return "";
+    return encodingName(it->second.encoding);
 }
 
 
 //delete a key 
-bool Database::del(const std::string& key) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    purgeExpired();
-    bool erased = false; //status of key to be deleted
-    erased |= kv_store.erase(key) > 0;
-    erased |= list_store.erase(key) > 0;
-    erased |= hash_store.erase(key) > 0;
-    return erased; //return staus of deletion
+bool Database::del(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    auto it = shard.dict.find(key);
+    if (it == shard.dict.end())
+        return false;
+    bool live = !it->second.isExpired(nowMs()); //expired key counts as already gone
+    eraseEntry(shard, it);
+    return live; //return staus of deletion
+}
+
+bool Database::unlink(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::optional<Value> detached;
+    bool live;
+    {
+        std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+        auto it = shard.dict.find(key);
+        if (it == shard.dict.end())
+            return false;
+        live = !it->second.isExpired(nowMs());
+        detached.emplace(eraseEntry(shard, it));
+    }
+    LazyFree::instance().dispose(std::move(*detached));
+    return live;
 }
 
 
 //setting expirty time of a key 
-bool Database::expire(const std::string& key, int seconds) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    purgeExpired();
-    
+int64_t Database::expire(std::string_view key, int seconds) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+
     //first checking if key acutally exist lol
-    bool exists = (kv_store.find(key) != kv_store.end()) ||
-                  (list_store.find(key) != list_store.end()) ||
-                  (hash_store.find(key) != hash_store.end());
+    Value* value = lookupWrite(shard, key);
+    if (!value)
+        return 0;
+
+    //absolute unix ms -> same meaning after a restart, past deadline -> expired, never NO_EXPIRE
+    int64_t when = nowMs() + static_cast<int64_t>(seconds) * 1000;
+    if (when <= 0) when = 1;
+    mutate(shard, *value, [when](Value& v) { v.expire_at = when; });
+    scheduleExpire(shard, key, when);
+    return when; //the append only file logs exactly this deadline
+}
+
+//absolute deadline, what the append only file records for EXPIRE -> replay keeps the original deadline
+bool Database::pexpireAt(std::string_view key, int64_t whenMs) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    Value* value = lookupWrite(shard, key);
+    if (!value)
+        return false;
+    //past deadline -> expired, never NO_EXPIRE
+    mutate(shard, *value, [whenMs](Value& v) { v.expire_at = whenMs <= 0 ? 1 : whenMs; });
+    scheduleExpire(shard, key, value->expire_at);
+    return true;
+}
+
+//remaining time to live in ms
+int64_t Database::pttl(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    auto it = shard.dict.find(key);
+    int64_t now = nowMs();
+    if (it == shard.dict.end() || it->second.isExpired(now))
+        return -2;
+    if (!it->second.hasExpire())
+        return -1;
+    return it->second.expire_at - now;
+}
 
-    //if not exist then fuck it
-    if (!exists)
+//drop the expiry, heap entry goes stale
+bool Database::persist(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    Value* value = lookupWrite(shard, key);
+    if (!value || !value->hasExpire())
         return false;
-    
-    //now() wont affected by system time {monotonic -> move forward} + add TTL to it
-    expiry_map[key] = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
-    return true;//success
-}
-
-
-//remove expired keys
-void Database::purgeExpired() {
-    auto now = std::chrono::steady_clock::now(); //get current monotonic time
-
-    //iterate in expiry_map 
-    for (auto it = expiry_map.begin(); it != expiry_map.end(); ) {
-        //if currentime > expired time set during key store
-        if (now > it->second) {
-            // attempt to remove from all stores
-            kv_store.erase(it->first);
-            list_store.erase(it->first);
-            hash_store.erase(it->first);
-            it = expiry_map.erase(it);
-        } else {
-            ++it;
+    mutate(shard, *value, [](Value& v) { v.expire_at = Value::NO_EXPIRE; });
+    return true;
+}
+
+//every ttl change pushes an entry and erased keys leave theirs behind, old ones only die when popped
+//so rebuild from the dict once stale entries clearly dominate (amortized O(1) per push / erase)
+//returns true when it rebuilt, caller holds the shard lock exclusively
+bool Database::compactExpires(Shard& shard) {
+    if (shard.expires.size() <= 2 * shard.volatile_keys + 64)
+        return false;
+    size_t dropped = 0, kept = 0;
+    for (const auto& entry : shard.expires) dropped += expireEntryMemory(entry.key);
+    shard.expires.clear();
+    for (const auto& pair : shard.dict) {
+        if (pair.second.hasExpire()) {
+            shard.expires.push_back({pair.second.expire_at, pair.first});
+            kept += expireEntryMemory(pair.first);
         }
     }
+    std::make_heap(shard.expires.begin(), shard.expires.end(), std::greater<ExpireEntry>());
+    charge(shard, kept, dropped);
+    return true;
 }
 
-//move value and expiration to newkey
-bool Database::rename(const std::string& oldKey, const std::string& newKey) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    purgeExpired();
-    bool found = false; //status that key is found 
-
-    //attempt to find in all maps
-    //in parallel because same key can be in multiple maps 
-    auto itKv = kv_store.find(oldKey);
-    if (itKv != kv_store.end()) {
-        kv_store[newKey] = itKv->second;
-        kv_store.erase(itKv);
-        found = true;
+//remember when key expires, caller holds the shard lock exclusively
+void Database::scheduleExpire(Shard& shard, std::string_view key, int64_t when) {
+    if (compactExpires(shard))
+        return; //key itself was already picked up from the dict
+    charge(shard, expireEntryMemory(key), 0);
+    shard.expires.push_back({when, std::string(key)});
+    std::push_heap(shard.expires.begin(), shard.expires.end(), std::greater<ExpireEntry>());
+}
+
+//pop due heap entries of one shard, at most limit of them, caller holds the lock exclusively
+size_t Database::expireShard(Shard& shard, int64_t now, size_t limit) {
+    size_t removed = 0;
+    while (limit-- > 0 && !shard.expires.empty() && shard.expires.front().when <= now) {
+        std::pop_heap(shard.expires.begin(), shard.expires.end(), std::greater<ExpireEntry>());
+        ExpireEntry entry = std::move(shard.expires.back());
+        shard.expires.pop_back();
+        charge(shard, 0, expireEntryMemory(entry.key));
+
+        auto it = shard.dict.find(entry.key);
+        //stale entry -> key gone, persisted or given a new ttl since
+        if (it == shard.dict.end() || it->second.expire_at != entry.when)
+            continue;
+        eraseEntry(shard, it);
+        removed++;
     }
+    return removed;
+}
+
+//a dict that stopped getting writes still finishes its rehash and frees the old bucket array
+bool Database::rehashShard(Shard& shard) {
+    static const size_t REHASH_BUCKETS = 100; //per lock hold, like one redis cron step
+    if (!shard.dict.rehashing()) return false;
+    size_t buckets = shard.dict.bucketCount();
+    bool more = shard.dict.rehashStep(REHASH_BUCKETS);
+    charge(shard, shard.dict.bucketCount() * sizeof(void*), buckets * sizeof(void*));
+    return more;
+}
 
-    auto itList = list_store.find(oldKey);
-    if (itList != list_store.end()) {
-        list_store[newKey] = itList->second;
-        list_store.erase(itList);
-        found = true;
+//bounded amount of work per call so the expirer never hogs the shard locks
+size_t Database::activeExpireCycle(int64_t budgetUs) {
+    static const size_t BATCH = 64; //heap pops per lock hold -> writers wait at most one batch
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::microseconds(budgetUs);
+    size_t removed = 0;
+    size_t idleShards = 0; //consecutive shards with nothing due
+
+    while (idleShards < shards.size() && std::chrono::steady_clock::now() < deadline) {
+        Shard& shard = *shards[expire_cursor];
+        size_t n;
+        bool rehashing;
+        {
+            std::unique_lock<ShardMutex> lock(shard.mutex);
+            n = expireShard(shard, nowMs(), BATCH);
+            rehashing = rehashShard(shard);
+        }
+        removed += n;
+        //shard still busy -> stay on it, otherwise move to the next one
+        //(an unfinished rehash keeps the cycle going round the shards until the budget runs out)
+        if (n < BATCH) {
+            expire_cursor = (expire_cursor + 1) % shards.size();
+            idleShards = (n == 0 && !rehashing) ? idleShards + 1 : 0;
+        }
     }
 
-    auto itHash = hash_store.find(oldKey);
-    if (itHash != hash_store.end()) {
-        hash_store[newKey] = itHash->second;
-        hash_store.erase(itHash);
-        found = true;
+    uint64_t took = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    expiry_stats.cycles.fetch_add(1, std::memory_order_relaxed);
+    expiry_stats.last_cycle_us.store(took, std::memory_order_relaxed);
+    if (took > expiry_stats.max_cycle_us.load(std::memory_order_relaxed))
+        expiry_stats.max_cycle_us.store(took, std::memory_order_relaxed);
+    expiry_stats.active_expired_keys.fetch_add(removed, std::memory_order_relaxed);
+    uint64_t total = expiry_stats.expired_keys.fetch_add(removed, std::memory_order_relaxed) + removed;
+
+    //expired keys/sec over the last full second window
+    uint64_t nowWall = nowMs();
+    if (expiry_stats.window_start_ms == 0) {
+        expiry_stats.window_start_ms = nowWall;
+        expiry_stats.window_base = total;
+    } else if (nowWall - expiry_stats.window_start_ms >= 1000) {
+        uint64_t elapsed = nowWall - expiry_stats.window_start_ms;
+        expiry_stats.expired_per_sec.store((total - expiry_stats.window_base) * 1000 / elapsed, std::memory_order_relaxed);
+        expiry_stats.window_start_ms = nowWall;
+        expiry_stats.window_base = total;
     }
+    return removed;
+}
 
-    //move expiry data to new key 
-    auto itExpire = expiry_map.find(oldKey);
-    if (itExpire != expiry_map.end()) {
-        expiry_map[newKey] = itExpire->second;
-        expiry_map.erase(itExpire);
+std::string Database::expiryInfo() const {
+    size_t pending = 0;
+    for (const auto& shard : shards) {
+        std::shared_lock<ShardMutex> lock(shard->mutex);
+        pending += shard->expires.size();
     }
+    std::ostringstream oss;
+    oss << "# Expiry\r\n";
+    oss << "expired_keys:" << expiry_stats.expired_keys.load(std::memory_order_relaxed) << "\r\n";
+    oss << "active_expired_keys:" << expiry_stats.active_expired_keys.load(std::memory_order_relaxed) << "\r\n";
+    oss << "expired_keys_per_sec:" << expiry_stats.expired_per_sec.load(std::memory_order_relaxed) << "\r\n";
+    oss << "expire_cycles:" << expiry_stats.cycles.load(std::memory_order_relaxed) << "\r\n";
+    oss << "expire_cycle_last_us:" << expiry_stats.last_cycle_us.load(std::memory_order_relaxed) << "\r\n";
+    oss << "expire_cycle_max_us:" << expiry_stats.max_cycle_us.load(std::memory_order_relaxed) << "\r\n";
+    oss << "expire_heap_entries:" << pending << "\r\n";
+    return oss.str();
+}
 
-    return found;//return status
+//move value and expiration to newkey
+bool Database::rename(std::string_view oldKey, std::string_view newKey) {
+    //both shards exclusively, lower index first (lock ordering rule), once if they are the same
+    size_t fromIdx = shardIndex(oldKey);
+    size_t toIdx = shardIndex(newKey);
+    Shard& from = *shards[fromIdx];
+    Shard& to = *shards[toIdx];
+    std::unique_lock<ShardMutex> first(shards[std::min(fromIdx, toIdx)]->mutex);
+    std::unique_lock<ShardMutex> second;
+    if (fromIdx != toIdx)
+        second = std::unique_lock<ShardMutex>(shards[std::max(fromIdx, toIdx)]->mutex);
+
+    Value* value = lookupWrite(from, oldKey);
+    if (!value)
+        return false;
+    if (oldKey == newKey)
+        return true;
+
+    //value carries its type, expiry and eviction clock, one move covers everything
+    charge(from, 0, entryMemory(oldKey, *value)); //sized before the move empties it
+    from.volatile_keys -= value->hasExpire();
+    Value moved = std::move(*value);
+    uint32_t clock = moved.lru;
+    size_t buckets = from.dict.bucketCount();
+    from.dict.erase(from.dict.find(oldKey));
+    from.dict.rehashStep();
+    charge(from, from.dict.bucketCount() * sizeof(void*), buckets * sizeof(void*));
+    int64_t when = moved.expire_at;
+    std::optional<Value> replaced;
+    auto it = to.dict.find(newKey);
+    if (it != to.dict.end()) { //rename overwrites the destination, its old value is freed after unlocking
+        mutate(to, it->second, [&](Value& v) {
+            replaced.emplace(std::move(v));
+            v = std::move(moved);
+        });
+    } else {
+        insertEntry(to, newKey, std::move(moved)).lru = clock;
+    }
+    if (when != Value::NO_EXPIRE)
+        scheduleExpire(to, newKey, when); //old entry under oldKey goes stale
+    if (replaced) {
+        if (second.owns_lock()) second.unlock();
+        first.unlock();
+        LazyFree::instance().dispose(std::move(*replaced));
+    }
+    return true;//return status
 }
 
 
@@ -181,335 +636,257 @@ bool Database::rename(const std::string& oldKey, const std::string& newKey) {
 
 
 
-//reteive list stored against key 
-std::vector<std::string> Database::lget(const std::string& key) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = list_store.find(key);
-    if (it != list_store.end()) {
-        return it->second; //return list
+bool Database::sliceOf(long start, long stop, size_t len, size_t& from, size_t& n) {
+    long size = static_cast<long>(len);
+    if (start < 0) start += size;
+    if (stop < 0) stop += size;
+    if (start < 0) start = 0;
+    if (stop >= size) stop = size - 1;
+    if (start > stop || start >= size) {
+        from = n = 0;
+        return false;
     }
-    return {}; //return empty result
+    from = static_cast<size_t>(start);
+    n = static_cast<size_t>(stop - start + 1);
+    return true;
 }
 
 //get the length list stored agains ekey
-ssize_t Database::llen(const std::string& key) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = list_store.find(key);
-    if (it != list_store.end()) 
-        return it->second.size(); //just the size
+ssize_t Database::llen(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    const Value* value = lookupRead(shard, key, ValueType::List);
+    if (value) 
+        return value->listSize(); //just the size
     return 0; //not found
 }
 
 //push at left of list
 //if no list must create one (auto work)
-void Database::lpush(const std::string& key, const std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    list_store[key].insert(list_store[key].begin(), value);
+void Database::lpush(std::string_view key, std::string_view value) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    mutate(shard, lookupOrCreate(shard, key, ValueType::List),
+           [value](Value& list) { list.listPushFront(value); }); //O(1) once it is a quicklist
 }
 
 //push at right
-void Database::rpush(const std::string& key, const std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    list_store[key].push_back(value);
+void Database::rpush(std::string_view key, std::string_view value) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    mutate(shard, lookupOrCreate(shard, key, ValueType::List), [value](Value& list) { list.listPushBack(value); });
 }
 
 
 //pop from left and return element 
-bool Database::lpop(const std::string& key, std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = list_store.find(key);
-    //two cond -> it should not point to end and it's list should not be empty
-    if (it != list_store.end() && !it->second.empty()) {
-        value = it->second.front();
-        it->second.erase(it->second.begin());
-        return true;
-    }
-    return false;
+//last element gone -> key gone too (no empty lists in the keyspace)
+bool Database::lpop(std::string_view key, std::string& value) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    Value* v = lookupWrite(shard, key, ValueType::List);
+    if (!v || !mutate(shard, *v, [&value](Value& list) { return list.listPopFront(value); }))
+        return false;
+    if (v->listSize() == 0) eraseEntry(shard, shard.dict.find(key));
+    return true;
 }
 
 //retrieve rightmost element from list and remove
-bool Database::rpop(const std::string& key, std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = list_store.find(key);
-    //two cond -> it should not point to end and it's list should not be empty
-    if (it != list_store.end() && !it->second.empty()) {
-        value = it->second.back();
-        it->second.pop_back();
-        return true;
-    }
-    return false;
+bool Database::rpop(std::string_view key, std::string& value) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    Value* v = lookupWrite(shard, key, ValueType::List);
+    if (!v || !mutate(shard, *v, [&value](Value& list) { return list.listPopBack(value); }))
+        return false;
+    if (v->listSize() == 0) eraseEntry(shard, shard.dict.find(key));
+    return true;
 }
 
 //remove count values from list stored at key index in list-map thats basically it
-int Database::lrem(const std::string& key, int count, const std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex);
+int Database::lrem(std::string_view key, int count, std::string_view value) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
     int removed = 0; //counter how many removed
-    auto it = list_store.find(key);
-    if (it == list_store.end()) 
+    Value* v = lookupWrite(shard, key, ValueType::List);
+    if (!v) 
         return 0; //not removed
 
-    auto& lst = it->second; 
-
-    if (count == 0) {
-        // iterate in list and remove all
-        auto new_end = std::remove(lst.begin(), lst.end(), value); //move elements not equal to value to front of list
-
-        removed = std::distance(new_end, lst.end()); //how many removed => diff of new end and old end pointer
-        lst.erase(new_end, lst.end()); //remove elements from logical end to actual end {here all values = value}
-    } else if (count > 0) {
-        // Remove from head to tail
-        //stopping condition -> removed == count as removed is 0 indexed 
-        for (auto iter = lst.begin(); iter != lst.end() && removed < count; ) {
-            if (*iter == value) {
-                iter = lst.erase(iter);
-                ++removed;
-            } else {
-                ++iter;
-            }
-        }
-    } else {
-        // count negative means remove from tail to head direction mod{count} number of values = value
-        for (auto riter = lst.rbegin(); riter != lst.rend() && removed < (-count); ) {
-            if (*riter == value) {
-                auto fwdIter = riter.base(); //forward iterator pointing at i+1 if rev iterator points at i
-                --fwdIter;//move one back i+1 -> i
-                fwdIter = lst.erase(fwdIter); //erase
-                ++removed;//inc count
-                riter = std::reverse_iterator<std::vector<std::string>::iterator>(fwdIter);//convert forward iterator to reverse iterator iterating on vector of string bcz of list obviousl
-
-            } else {
-                ++riter; //move one back i -> i-1
-            }
-        }
-    }
+    //count 0 -> all, > 0 head to tail, < 0 tail to head mod{count} values
+    removed = static_cast<int>(mutate(shard, *v, [&](Value& list) { return list.listRemove(value, count); }));
+    if (v->listSize() == 0) eraseEntry(shard, shard.dict.find(key));
     return removed; //return count;
 }
 
 
 //need params -> value, index, key
 //get value at index
-bool Database::lindex(const std::string& key, int index, std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = list_store.find(key);
-    if (it == list_store.end()) 
+bool Database::lindex(std::string_view key, int index, std::string& value) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    const Value* v = lookupRead(shard, key, ValueType::List);
+    if (!v) 
         return false;//no index
 
-    const auto& lst = it->second; //ref to vector of strings
-
-    //count from left
-    if (index < 0)
-        index = lst.size() + index; //convert to normal index
-
-    //invalid negative index provided -> exceeding list size after forward conversion
-    //damn .size() return size_t {unsigned shit} must convert to int {signed shit}
-    //but what if size exceed INT_MAX fuck it will see later
-    if (index < 0 || index >= static_cast<int>(lst.size()))
-        return false;
-
-    //put value in the value var 
-    value = lst[index];
-    return true;//success
+    //negative index counts from the tail, out of range -> false
+    //skips whole nodes by their count then walks one small node
+    return v->listIndex(index, value);
 }
 
 //set value at index in list store in key counterpart 
 //damn too mmany safety checks should be done
-bool Database::lset(const std::string& key, int index, const std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = list_store.find(key);
-    if (it == list_store.end()) 
+bool Database::lset(std::string_view key, int index, std::string_view value) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    Value* v = lookupWrite(shard, key, ValueType::List);
+    if (!v) 
         return false; //not found key
 
-    auto& lst = it->second; //get ref to vector of string 
-    if (index < 0)
-        index = lst.size() + index; //nigga index -> normal index
-    if (index < 0 || index >= static_cast<int>(lst.size()))
-        return false;
-    
-    lst[index] = value; //set the value
+    //negative index from tail, false when out of range
+    return mutate(shard, *v, [&](Value& list) { return list.listSet(index, value); });
+}
+
+//keep only [start, stop]
+bool Database::ltrim(std::string_view key, long start, long stop) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    Value* v = lookupWrite(shard, key, ValueType::List);
+    if (!v)
+        return true; //nothing to trim is still OK
+    size_t from, n;
+    if (!sliceOf(start, stop, v->listSize(), from, n))
+        eraseEntry(shard, shard.dict.find(key)); //no empty lists in the keyspace
+    else
+        mutate(shard, *v, [from, n](Value& list) { list.listTrim(from, n); });
     return true;
 }
 
+long Database::linsert(std::string_view key, bool after, std::string_view pivot, std::string_view value) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    Value* v = lookupWrite(shard, key, ValueType::List);
+    if (!v)
+        return 0;
+    if (!mutate(shard, *v, [&](Value& list) { return list.listInsert(pivot, value, after); }))
+        return -1;
+    return static_cast<long>(v->listSize());
+}
+
+//walks from the chosen end and stops as soon as it has enough matches
+std::vector<long> Database::lpos(std::string_view key, std::string_view item, long rank, size_t count, size_t maxlen) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    std::vector<long> found;
+    const Value* v = lookupRead(shard, key, ValueType::List);
+    if (!v)
+        return found;
+
+    bool fromTail = rank < 0;
+    size_t skip = static_cast<size_t>(fromTail ? -rank : rank) - 1; //matches to pass over first
+    long size = static_cast<long>(v->listSize());
+    size_t seen = 0;
+    v->listWalk(fromTail, [&](std::string_view elem) {
+        if (maxlen && seen == maxlen) return false;
+        long idx = fromTail ? size - 1 - static_cast<long>(seen) : static_cast<long>(seen);
+        seen++;
+        if (elem != item) return true;
+        if (skip) {
+            skip--;
+            return true;
+        }
+        found.push_back(idx);
+        return count == 0 || found.size() < count;
+    });
+    return found;
+}
+
 // Hash map<str,map> operations 
-bool Database::hset(const std::string& key, const std::string& field, const std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    hash_store[key][field] = value; //set value to field
+bool Database::hset(std::string_view key, std::string_view field, std::string_view value) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    mutate(shard, lookupOrCreate(shard, key, ValueType::Hash),
+           [&](Value& hash) { hash.hashSet(field, value); }); //set value to field
     return true;
 }
 
-bool Database::hget(const std::string& key, const std::string& field, std::string& value) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = hash_store.find(key); //point iterator to map
-    if (it != hash_store.end()) {
-        auto f = it->second.find(field); //find field and point iterator to it
-        if (f != it->second.end()) {
-            value = f->second; //retreive data from pointer -> second and put in value ref
-            return true; //success
-        }
-    }
+bool Database::hget(std::string_view key, std::string_view field, std::string& value) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    const Value* v = lookupRead(shard, key, ValueType::Hash);
+    if (v)
+        return v->hashGet(field, value); //copies into value ref on success
     return false; //failure
 }
 
 
 //check if field exist
-bool Database::hexists(const std::string& key, const std::string& field) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = hash_store.find(key);
-    if (it != hash_store.end())
-        return it->second.find(field) != it->second.end(); //return bool 
+bool Database::hexists(std::string_view key, std::string_view field) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    const Value* v = lookupRead(shard, key, ValueType::Hash);
+    if (v)
+        return v->hashExists(field); //return bool 
     return false;//failure -> only return when key not found not related to map counterpart of key
 }
 
-//clear field map at key 
-bool Database::hdel(const std::string& key, const std::string& field) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = hash_store.find(key);
-    if (it != hash_store.end())
-        return it->second.erase(field) > 0; //success
-    return false;//key not found
+//clear field map at key, last field gone -> key gone
+bool Database::hdel(std::string_view key, std::string_view field) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    Value* v = lookupWrite(shard, key, ValueType::Hash);
+    if (!v)
+        return false;//key not found
+    bool erased = mutate(shard, *v, [field](Value& hash) { return hash.hashDel(field); });
+    if (v->hashSize() == 0) eraseEntry(shard, shard.dict.find(key));
+    return erased; //success
 }
 
-//get all field at given key 
-std::unordered_map<std::string, std::string> Database::hgetall(const std::string& key) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    if (hash_store.find(key) != hash_store.end())
-        return hash_store[key]; //return complete map
-    return {}; //empty map
+ssize_t Database::hlen(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    const Value* v = lookupRead(shard, key, ValueType::Hash);
+    return v ? v->hashSize() : 0;
 }
 
-//all field names retreived stored at key 
-std::vector<std::string> Database::hkeys(const std::string& key) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    std::vector<std::string> fields;
-    auto it = hash_store.find(key);
-    if (it != hash_store.end()) {
-        for (const auto& pair: it->second)
-            fields.push_back(pair.first);
-    }
-    return fields;
+bool Database::hmset(std::string_view key, const std::vector<std::pair<std::string_view, std::string_view>>& fieldValues) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+    mutate(shard, lookupOrCreate(shard, key, ValueType::Hash), [&fieldValues](Value& hash) {
+        for (const auto& pair: fieldValues) {
+            hash.hashSet(pair.first, pair.second);
+        }
+    });
+    return true;
 }
 
-std::vector<std::string> Database::hvals(const std::string& key) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    std::vector<std::string> values;
-    auto it = hash_store.find(key);
-    if (it != hash_store.end()) {
-        for (const auto& pair: it->second)
-            values.push_back(pair.second);
+//compact hash is small by definition -> all of it at once, like redis
+uint64_t Database::hscan(std::string_view key, uint64_t cursor, size_t count, std::string_view pattern,
+                         std::vector<std::pair<std::string, std::string>>& out) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    const Value* v = lookupRead(shard, key, ValueType::Hash);
+    if (!v) return 0;
+
+    bool all = pattern.empty() || pattern == "*";
+    auto collect = [&](std::string_view field, std::string_view value) {
+        if (all || globMatch(pattern, field)) out.emplace_back(field, value);
+    };
+    if (v->encoding == ValueEncoding::ListPack) {
+        v->hashForEach(collect);
+        return 0;
     }
-    return values;
-}
 
-ssize_t Database::hlen(const std::string& key) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    auto it = hash_store.find(key);
-    return (it != hash_store.end()) ? it->second.size() : 0;
-}
-
-bool Database::hmset(const std::string& key, const std::vector<std::pair<std::string, std::string>>& fieldValues) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    for (const auto& pair: fieldValues) {
-        hash_store[key][pair.first] = pair.second;
-    }
-    return true;
+    size_t visited = 0;
+    size_t steps = 0, maxSteps = count * 10;
+    do {
+        cursor = v->hash().scan(cursor, [&](const std::string& field, const std::string& value) {
+            visited++;
+            collect(field, value);
+        });
+        steps++;
+    } while (cursor != 0 && visited < count && steps < maxSteps);
+    return cursor;
 }
 
 //--------------------
 //--------------------
 
-
-
-
-bool Database::dump(const std::string& filename) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    std::ofstream ofs(filename, std::ios::binary); //open in binary mode
-    if (!ofs) return false;//if no permission return false
-
-    //key value store
-    // K name jaggiboss
-    // K age 21
-
-
-    for (const auto& kv: kv_store) {
-        ofs << "K " << kv.first << " " << kv.second << "\n";
-    }
-    for (const auto& kv : list_store) {
-        ofs << "L " << kv.first;
-        for (const auto& item : kv.second)
-            ofs << " " << item;
-        ofs << "\n";
-    }
-    for (const auto& kv : hash_store) {
-        ofs << "H " << kv.first;
-        for (const auto& field_val : kv.second) 
-            ofs << " " << field_val.first << ":" << field_val.second;
-        ofs << "\n";
-    }
-    return true;
-}
-
-/*
-Key-Value (K)
-kv_store["name"] = "jaggi";
-kv_store["city"] = "yash";
-
-List (L)
-list_store["fruits"] = {"apple", "banana", "orange"};
-list_store["colors"] = {"red", "green", "blue"};
-
-Hash (H)
-hash_store["user:100"] = {
-    {"name", "jaggi"},
-    {"age", "21"},
-    {"email", "jms21082003@gmail.com"}
-};
-
-hash_store["user:200"] = {
-    {"name", "yash"},
-    {"age", "21"},
-    {"email", "yashbkl@gmail.com"}
-};
-*/
-bool Database::load(const std::string& filename) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    std::ifstream ifs(filename, std::ios::binary);
-    if (!ifs) return false;
-
-    kv_store.clear();
-    list_store.clear();
-    hash_store.clear();
-
-    std::string line;
-    while (std::getline(ifs, line)) {
-        std::istringstream iss(line);
-        char type;
-        iss >> type;
-        if (type == 'K') {
-            std::string key, value;
-            iss >> key >> value;
-            kv_store[key] = value;
-        } else if (type == 'L') {
-            std::string key;
-            iss >> key;
-            std::string item;
-            std::vector<std::string> list;
-            while (iss >> item)
-                list.push_back(item);
-            list_store[key] = list;
-        } else if (type == 'H') {
-            std::string key;
-            iss >> key;
-            std::unordered_map<std::string, std::string> hash;
-            std::string pair;
-            while (iss >> pair) {
-                auto pos = pair.find(':');
-                if (pos != std::string::npos) {
-                    std::string field = pair.substr(0, pos);
-                    std::string value = pair.substr(pos+1);
-                    hash[field] = value;
-                }
-            }
-            hash_store[key] = hash;
-        }
-    }
-    return true;
-}
\ No newline at end of file
+//dump/load -> Snapshot.cpp
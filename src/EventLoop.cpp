@@ -0,0 +1,335 @@
+#include "../include/EventLoop.h"
+#include "../include/CommandHandler.h"
+#include "../include/Aof.h"
+
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+static const int MAX_EVENTS = 256;
+static const size_t READ_CHUNK = 16 * 1024;
+static const size_t PROCESS_BATCH = 64 * 1024;  //pipelined input runs once this much is buffered
+static const size_t READ_BUDGET = 256 * 1024;   //per connection per wakeup, then the others get a turn
+static const size_t INBUF_KEEP = 1024 * 1024;   //bigger idle input buffers are released
+static const int WRITE_IOVECS = 64;
+
+ClientLimits clientLimits;
+
+EventLoop::EventLoop(int id, int listen_fd, CommandHandler& handler)
+    : loop_id(id), listen_fd(listen_fd), epoll_fd(-1), wake_fd(-1), running(true), cmdHandler(handler) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    //listening socket is edge triggered too -> accept until EAGAIN
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+
+    epoll_event wake{};
+    wake.events = EPOLLIN;
+    wake.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &wake);
+}
+
+EventLoop::~EventLoop() {
+    for (auto& pair : connections) {
+        close(pair.first);
+    }
+    connections.clear();
+    if (wake_fd != -1) close(wake_fd);
+    if (epoll_fd != -1) close(epoll_fd);
+}
+
+void EventLoop::stop() {
+    running = false;
+    uint64_t one = 1;
+    //return value ignored on purpose, loop also checks running flag
+    ssize_t n = write(wake_fd, &one, sizeof(one));
+    (void)n;
+}
+
+void EventLoop::run() {
+    if (epoll_fd < 0 || wake_fd < 0) {
+        std::cerr << "event loop setup failed \n";
+        return;
+    }
+    //running starts true in the constructor -> a stop() before run() is not lost
+    epoll_event events[MAX_EVENTS];
+
+    while (running) {
+        //input left behind by the deferred flush -> poll without blocking, read it this tick
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, resumed_reads.empty() ? -1 : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "epoll_wait failed \n";
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+
+            if (fd == wake_fd) {
+                uint64_t val;
+                ssize_t r = read(wake_fd, &val, sizeof(val));
+                (void)r;
+                continue;
+            }
+            if (fd == listen_fd) {
+                acceptConnections();
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue; //closed earlier in this batch
+            Connection& conn = *it->second;
+
+            if (ev & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(conn);
+                continue;
+            }
+            if (ev & EPOLLIN) {
+                handleRead(conn);
+                //read path may have closed it
+                if (connections.find(fd) == connections.end()) continue;
+            }
+            if (ev & EPOLLOUT) {
+                handleWrite(conn);
+            }
+        }
+
+        if (!resumed_reads.empty()) {
+            std::vector<int> resumed;
+            resumed.swap(resumed_reads);
+            for (int fd : resumed) {
+                auto it = connections.find(fd);
+                if (it != connections.end()) handleRead(*it->second);
+            }
+        }
+
+        //appendfsync always -> one group commit for the whole tick, then the held replies go out
+        //swapped out first: nothing queued while flushing is sent before its own fsync
+        if (!deferred_writes.empty()) {
+            std::vector<int> ready;
+            ready.swap(deferred_writes);
+            AppendOnlyFile* aof = AppendOnlyFile::active();
+            bool durable = !aof || aof->waitDurable();
+            //write or fsync failed -> their OKs were never earned, the clients are dropped instead
+            if (!durable) std::cerr << "aof: dropping " << ready.size() << " client(s) waiting for a failed fsync\n";
+            flushing_deferred = true;
+            for (int fd : ready) {
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                if (!durable) {
+                    closeConnection(*it->second);
+                    continue;
+                }
+                it->second->awaiting_fsync = false;
+                handleWrite(*it->second);
+            }
+            flushing_deferred = false;
+        }
+    }
+}
+
+//ip:port of the peer, formatted once per connection
+static std::string peerAddress(const sockaddr_storage& peer) {
+    char ip[INET6_ADDRSTRLEN] = "?";
+    unsigned port = 0;
+    if (peer.ss_family == AF_INET) {
+        const auto* in = reinterpret_cast<const sockaddr_in*>(&peer);
+        inet_ntop(AF_INET, &in->sin_addr, ip, sizeof(ip));
+        port = ntohs(in->sin_port);
+    } else if (peer.ss_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const sockaddr_in6*>(&peer);
+        inet_ntop(AF_INET6, &in6->sin6_addr, ip, sizeof(ip));
+        port = ntohs(in6->sin6_port);
+    }
+    return std::string(ip) + ":" + std::to_string(port);
+}
+
+void EventLoop::acceptConnections() {
+    while (true) {
+        sockaddr_storage peer{};
+        socklen_t peerLen = sizeof(peer);
+        int client_socket = accept4(listen_fd, reinterpret_cast<sockaddr*>(&peer), &peerLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EINTR) continue;
+            //EAGAIN -> backlog drained, anything else -> try again on next edge
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                std::cerr << "Error Accepting Client Connection\n";
+            return;
+        }
+
+        int opt = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        //register once for both directions, edge triggered so no EPOLL_CTL_MOD churn later
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = client_socket;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_socket, &ev) < 0) {
+            close(client_socket);
+            continue;
+        }
+        connections[client_socket] = std::make_unique<Connection>(client_socket, peerAddress(peer));
+        counters.connected_clients.fetch_add(1, std::memory_order_relaxed);
+        counters.total_connections.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void EventLoop::handleRead(Connection& conn) {
+    //pending reply -> do not pile up more work, EPOLLOUT will resume reading
+    if (conn.state != ConnState::Reading) return;
+
+    //edge triggered -> drain until EAGAIN, or until the read budget is used up and we come back next tick
+    bool peerClosed = false;
+    bool budgetLeft = true;
+    uint64_t received = 0;
+    while (true) {
+        //pipelined commands -> run what is complete every PROCESS_BATCH bytes, not after the whole drain
+        //(skipped while a known bulk is still arriving, the parser would only wait for it)
+        if (conn.inlen >= PROCESS_BATCH && conn.parser.sizeHint() <= conn.inlen) processInput(conn);
+        if (overLimits(conn)) return;
+        if (received >= READ_BUDGET) {
+            budgetLeft = false;
+            break;
+        }
+        //big bulk in flight -> grow once to its full size instead of chunk by chunk
+        size_t want = std::max(conn.inlen + READ_CHUNK, conn.parser.sizeHint());
+        if (conn.inbuf.size() < want) conn.inbuf.resize(std::max(want, conn.inbuf.size() * 2));
+        ssize_t bytes = recv(conn.fd, &conn.inbuf[conn.inlen], conn.inbuf.size() - conn.inlen, 0);
+        if (bytes > 0) {
+            conn.inlen += static_cast<size_t>(bytes);
+            received += static_cast<uint64_t>(bytes);
+            continue;
+        }
+        if (bytes == 0) {
+            peerClosed = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        closeConnection(conn);
+        return;
+    }
+    if (received) counters.net_input_bytes.fetch_add(received, std::memory_order_relaxed);
+    //no EAGAIN seen -> no new edge will come, re-armed by hand for the next tick
+    if (!budgetLeft) resumed_reads.push_back(conn.fd);
+
+    processInput(conn);
+    if (overLimits(conn)) return;
+
+    if (peerClosed) conn.state = ConnState::Closing;
+    //logged writes not on disk yet -> reply after the end of tick fsync
+    AppendOnlyFile* aof = AppendOnlyFile::active();
+    if (aof && aof->needsSync()) {
+        if (!conn.awaiting_fsync) deferred_writes.push_back(conn.fd);
+        conn.awaiting_fsync = true; //EPOLLOUT in the same tick must not send them early
+        return;
+    }
+    //all replies of the batch leave in one send
+    handleWrite(conn);
+}
+
+//run every complete command in inbuf, keep a partial tail for the next read
+void EventLoop::processInput(Connection& conn) {
+    uint64_t executed = 0;
+    RespWriter out(conn.outbuf);
+    while (conn.state != ConnState::Closing) {
+        ParseStatus status = conn.parser.parse(std::string_view(conn.inbuf.data(), conn.inlen), conn.args);
+        if (status == ParseStatus::Incomplete) break;
+        if (status == ParseStatus::Error) {
+            //stream is out of sync, reply once then drop the client
+            out.error("Error: Protocol error: " + conn.parser.error());
+            conn.state = ConnState::Closing;
+            break;
+        }
+        if (conn.args.empty()) continue; //blank inline line
+        cmdHandler.processCommand(conn.args, out, conn.addr);
+        executed++;
+    }
+    if (executed) counters.total_commands.fetch_add(executed, std::memory_order_relaxed);
+
+    //drop consumed bytes, partial command moves to the front
+    size_t consumed = conn.parser.consumed();
+    if (consumed == conn.inlen) {
+        conn.inlen = 0;
+        conn.parser.discard(consumed);
+        if (conn.inbuf.size() > INBUF_KEEP) std::string().swap(conn.inbuf); //after a huge bulk
+    } else if (consumed > 0) {
+        std::memmove(&conn.inbuf[0], &conn.inbuf[consumed], conn.inlen - consumed);
+        conn.inlen -= consumed;
+        conn.parser.discard(consumed);
+    }
+}
+
+//chunks + big values leave together, up to WRITE_IOVECS segments per syscall
+void EventLoop::handleWrite(Connection& conn) {
+    if (conn.awaiting_fsync) return; //the end of tick flush sends them
+    iovec iov[WRITE_IOVECS];
+    while (!conn.outbuf.empty()) {
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = conn.outbuf.gather(iov, WRITE_IOVECS);
+        ssize_t sent = sendmsg(conn.fd, &msg, MSG_NOSIGNAL); //writev + MSG_NOSIGNAL
+        if (sent > 0) {
+            conn.outbuf.consume(static_cast<size_t>(sent));
+            counters.net_output_bytes.fetch_add(static_cast<uint64_t>(sent), std::memory_order_relaxed);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            //kernel buffer full -> wait for the EPOLLOUT edge
+            if (conn.state == ConnState::Reading) conn.state = ConnState::Writing;
+            return;
+        }
+        closeConnection(conn);
+        return;
+    }
+
+    //everything flushed
+
+    if (conn.state == ConnState::Closing) {
+        closeConnection(conn);
+        return;
+    }
+    if (conn.state == ConnState::Writing) {
+        //we skipped reads while blocked on output, drain what arrived meanwhile
+        conn.state = ConnState::Reading;
+        //inside the deferred flush -> next tick, its commands get their own fsync
+        if (flushing_deferred) resumed_reads.push_back(conn.fd);
+        else handleRead(conn);
+    }
+}
+
+//a single command bigger than the query limit (or announcing a bulk that big), or replies piling up
+//for a client that does not read
+bool EventLoop::overLimits(Connection& conn) {
+    const char* which = nullptr;
+    if (conn.inlen >= clientLimits.query_buffer || conn.parser.sizeHint() > clientLimits.query_buffer)
+        which = "query";
+    else if (clientLimits.output_buffer && conn.outbuf.size() > clientLimits.output_buffer) which = "output";
+    if (!which) return false;
+    std::cerr << "client " << conn.addr << " closed: " << which << " buffer limit reached\n";
+    closeConnection(conn);
+    return true;
+}
+
+void EventLoop::closeConnection(Connection& conn) {
+    int fd = conn.fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd); //conn is dangling after this
+    counters.connected_clients.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,312 @@
+#include "../include/Database.h"
+#include "../include/LazyFree.h"
+
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+
+/*
+maxmemory + eviction
+
+accounting: every shard keeps the bytes of its entries in used_memory
+  entry = Dict node (key + Value inline) + key heap bytes + Value::memoryUsage()
+  + bucket arrays + expiry heap entries
+  insertEntry / eraseEntry / mutate keep it exact under the exclusive lock, no walk is ever needed
+  it is an estimate of the allocations (no malloc headers / rounding), not RSS
+
+eviction: approximate like redis, no global LRU list to maintain on every read
+  each key has 32 bits of clock in Value::lru
+    lru policies -> coarse monotonic time in LRU_CLOCK_MS ticks (wraps after ~497 days)
+    lfu policy   -> minutes (16 bits) << 8 | log counter (8 bits), the counter decays by one per
+                    idle minute and grows with probability 1 / ((counter - LFU_INIT) * LFU_LOG_FACTOR + 1)
+  a write command that may grow memory first calls evictionCandidate / evictKey until used <= maxmemory
+  each candidate call samples `samples` keys in a few shards into a pool of the POOL_SIZE best
+  candidates seen so far, then hands out the best one
+*/
+
+namespace {
+
+const uint32_t LRU_CLOCK_MS = 10;
+const uint32_t LFU_INIT = 5;          //new keys start here so they are not evicted right away
+const double LFU_LOG_FACTOR = 10;     //~1M hits to saturate 255, same as redis lfu-log-factor
+const uint32_t LFU_DECAY_MINUTES = 1; //redis lfu-decay-time
+const size_t POOL_SIZE = 16;
+const size_t SHARDS_PER_CANDIDATE = 4;
+
+//coarse clock -> a few ns per read instead of a full clock_gettime
+uint64_t monotonicMs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint32_t lruClock() {
+    return static_cast<uint32_t>(monotonicMs() / LRU_CLOCK_MS);
+}
+
+uint32_t lfuMinutes() {
+    return static_cast<uint32_t>(monotonicMs() / 60000) & 0xFFFF;
+}
+
+//counter after the idle minutes since its last access are taken off
+uint32_t lfuDecayed(uint32_t clock) {
+    uint32_t counter = clock & 0xFF;
+    uint32_t idle = (lfuMinutes() - (clock >> 8)) & 0xFFFF;
+    uint32_t periods = idle / LFU_DECAY_MINUTES;
+    return periods >= counter ? 0 : counter - periods;
+}
+
+//xorshift per thread, the lfu coin flip and the sample start do not need more
+uint64_t randomNumber() {
+    thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<uintptr_t>(&state);
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+uint32_t lfuIncrement(uint32_t counter) {
+    if (counter == 255) return counter;
+    double base = counter > LFU_INIT ? counter - LFU_INIT : 0;
+    double p = 1.0 / (base * LFU_LOG_FACTOR + 1);
+    double r = static_cast<double>(randomNumber() >> 11) / static_cast<double>(1ull << 53);
+    return r < p ? counter + 1 : counter;
+}
+
+bool usesLru(EvictionPolicy policy) {
+    return policy == EvictionPolicy::AllKeysLru || policy == EvictionPolicy::VolatileLru;
+}
+
+bool volatileOnly(EvictionPolicy policy) {
+    return policy == EvictionPolicy::VolatileLru || policy == EvictionPolicy::VolatileTtl;
+}
+
+std::string humanBytes(size_t bytes) {
+    static const char* units[] = {"B", "K", "M", "G", "T"};
+    double v = static_cast<double>(bytes);
+    size_t u = 0;
+    while (v >= 1024 && u < 4) {
+        v /= 1024;
+        u++;
+    }
+    std::ostringstream oss;
+    oss.setf(std::ios::fixed);
+    oss.precision(2);
+    oss << v << units[u];
+    return oss.str();
+}
+
+} // namespace
+
+bool parseEvictionPolicy(std::string_view text, EvictionPolicy& out) {
+    if (text == "noeviction") out = EvictionPolicy::NoEviction;
+    else if (text == "allkeys-lru") out = EvictionPolicy::AllKeysLru;
+    else if (text == "allkeys-lfu") out = EvictionPolicy::AllKeysLfu;
+    else if (text == "volatile-lru") out = EvictionPolicy::VolatileLru;
+    else if (text == "volatile-ttl") out = EvictionPolicy::VolatileTtl;
+    else return false;
+    return true;
+}
+
+const char* evictionPolicyName(EvictionPolicy policy) {
+    switch (policy) {
+        case EvictionPolicy::NoEviction: return "noeviction";
+        case EvictionPolicy::AllKeysLru: return "allkeys-lru";
+        case EvictionPolicy::AllKeysLfu: return "allkeys-lfu";
+        case EvictionPolicy::VolatileLru: return "volatile-lru";
+        case EvictionPolicy::VolatileTtl: return "volatile-ttl";
+    }
+    return "unknown";
+}
+
+//---------- accounting ----------
+
+size_t Database::entryMemory(std::string_view key, const Value& value) {
+    return Dict<Value>::NODE_BYTES + stringHeapBytes(key.size()) + value.memoryUsage();
+}
+
+size_t Database::expireEntryMemory(std::string_view key) {
+    return sizeof(ExpireEntry) + stringHeapBytes(key.size());
+}
+
+//plain load + store, every writer of a shard holds its exclusive lock
+void Database::charge(Shard& shard, size_t add, size_t sub) {
+    shard.used_memory.store(shard.used_memory.load(std::memory_order_relaxed) + add - sub,
+                            std::memory_order_relaxed);
+}
+
+//key must not be in the dict yet
+Value& Database::insertEntry(Shard& shard, std::string_view key, Value&& value) {
+    size_t buckets = shard.dict.bucketCount(); //may grow (rehash started) or shrink (rehash done)
+    Value& stored = shard.dict.emplace(std::string(key), std::move(value)).first->second;
+    charge(shard, entryMemory(key, stored) + shard.dict.bucketCount() * sizeof(void*), buckets * sizeof(void*));
+    shard.volatile_keys += stored.hasExpire();
+    initClock(stored);
+    return stored;
+}
+
+//a key with a ttl leaves a stale heap entry behind -> may be the one that triggers compaction
+Value Database::eraseEntry(Shard& shard, Dict<Value>::iterator it) {
+    bool hadExpire = it->second.hasExpire();
+    size_t buckets = shard.dict.bucketCount();
+    charge(shard, 0, entryMemory(it->first, it->second));
+    Value erased = std::move(it->second);
+    shard.dict.erase(it);
+    shard.dict.rehashStep();
+    charge(shard, shard.dict.bucketCount() * sizeof(void*), buckets * sizeof(void*));
+    if (hadExpire) {
+        shard.volatile_keys--;
+        compactExpires(shard);
+    }
+    return erased;
+}
+
+void Database::recountMemory(Shard& shard) {
+    size_t bytes = shard.dict.bucketCount() * sizeof(void*);
+    shard.volatile_keys = 0;
+    for (const auto& pair : shard.dict) {
+        bytes += entryMemory(pair.first, pair.second);
+        shard.volatile_keys += pair.second.hasExpire();
+    }
+    for (const auto& entry : shard.expires) bytes += expireEntryMemory(entry.key);
+    shard.used_memory.store(bytes, std::memory_order_relaxed);
+}
+
+size_t Database::usedMemory() const {
+    size_t total = 0;
+    for (const auto& shard : shards) total += shard->used_memory.load(std::memory_order_relaxed);
+    return total;
+}
+
+long long Database::memoryUsage(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::shared_lock<ShardMutex> lock(shard.mutex); //readers share the shard
+    auto it = shard.dict.find(key);
+    if (it == shard.dict.end() || it->second.isExpired(nowMs()))
+        return -1;
+    return static_cast<long long>(entryMemory(it->first, it->second));
+}
+
+//---------- clocks ----------
+
+void Database::initClock(Value& value) const {
+    if (usesLru(eviction.policy)) value.lru = lruClock();
+    else if (eviction.policy == EvictionPolicy::AllKeysLfu) value.lru = (lfuMinutes() << 8) | LFU_INIT;
+}
+
+//readers race on the clock of a hot key -> relaxed atomics, a lost lfu increment does not matter
+//the store is skipped when nothing changed so a hot key's cache line is not written by every read
+void Database::touch(const Value& value) const {
+    if (usesLru(eviction.policy)) {
+        std::atomic_ref<uint32_t> clock(value.lru);
+        uint32_t now = lruClock();
+        if (clock.load(std::memory_order_relaxed) != now) clock.store(now, std::memory_order_relaxed);
+    } else if (eviction.policy == EvictionPolicy::AllKeysLfu) {
+        std::atomic_ref<uint32_t> clock(value.lru);
+        uint32_t old = clock.load(std::memory_order_relaxed);
+        uint32_t next = (lfuMinutes() << 8) | lfuIncrement(lfuDecayed(old));
+        if (next != old) clock.store(next, std::memory_order_relaxed);
+    }
+}
+
+//---------- eviction ----------
+
+//startup, after loading -> every loaded key counts as just used
+void Database::configureMemory(size_t maxBytes, EvictionPolicy policy, size_t samples) {
+    auto locks = lockAllExclusive();
+    eviction.maxmemory = maxBytes;
+    eviction.policy = policy;
+    eviction.samples = samples;
+    for (auto& shard : shards) {
+        for (auto& pair : shard->dict) initClock(pair.second);
+    }
+}
+
+//volatile policies sample the expiry heap (only keys with a ttl, entries may be stale),
+//the others sample the dict itself
+void Database::sampleForEviction(Shard& shard) {
+    std::shared_lock<ShardMutex> lock(shard.mutex);
+    EvictionPolicy policy = eviction.policy;
+    uint32_t lruNow = lruClock();
+
+    auto offer = [&](const std::string& key, const Value& value) {
+        uint32_t clock = std::atomic_ref<uint32_t>(value.lru).load(std::memory_order_relaxed);
+        uint64_t score;
+        if (usesLru(policy)) score = static_cast<uint32_t>(lruNow - clock); //idle ticks
+        else if (policy == EvictionPolicy::AllKeysLfu) score = 255 - lfuDecayed(clock);
+        else score = UINT64_MAX - static_cast<uint64_t>(value.expire_at); //nearest deadline first
+
+        auto& pool = eviction.pool;
+        for (const auto& c : pool)
+            if (c.key == key) return;
+        if (pool.size() == POOL_SIZE && score <= pool.front().score) return;
+        auto pos = std::upper_bound(pool.begin(), pool.end(), score,
+                                    [](uint64_t s, const EvictionCandidate& c) { return s < c.score; });
+        pool.insert(pos, {score, key});
+        if (pool.size() > POOL_SIZE) pool.erase(pool.begin());
+    };
+
+    if (!volatileOnly(policy)) {
+        shard.dict.sample(randomNumber(), eviction.samples, offer);
+        return;
+    }
+    if (shard.expires.empty()) return;
+    for (size_t i = 0; i < eviction.samples; i++) {
+        const ExpireEntry& entry = shard.expires[randomNumber() % shard.expires.size()];
+        auto it = shard.dict.find(entry.key);
+        if (it != shard.dict.end() && it->second.expire_at == entry.when)
+            offer(it->first, it->second);
+    }
+}
+
+bool Database::evictionCandidate(std::string& key) {
+    if (eviction.policy == EvictionPolicy::NoEviction) return false;
+    std::lock_guard<std::mutex> guard(eviction.mutex);
+    //a few shards per call, all of them when the pool ran dry
+    size_t rounds = std::min(SHARDS_PER_CANDIDATE, shards.size());
+    for (size_t i = 0; i < shards.size() && (i < rounds || eviction.pool.empty()); i++) {
+        sampleForEviction(*shards[eviction.cursor]);
+        eviction.cursor = (eviction.cursor + 1) % shards.size();
+    }
+    if (eviction.pool.empty()) return false;
+    key = std::move(eviction.pool.back().key);
+    eviction.pool.pop_back();
+    return true;
+}
+
+bool Database::evictKey(std::string_view key) {
+    Shard& shard = shardFor(key);
+    std::optional<Value> victim;
+    size_t bytes;
+    {
+        std::unique_lock<ShardMutex> lock(shard.mutex); //writers own the shard
+        auto it = shard.dict.find(key);
+        if (it == shard.dict.end()) return false;
+        if (volatileOnly(eviction.policy) && !it->second.hasExpire()) return false; //persisted since sampled
+        bytes = entryMemory(it->first, it->second);
+        victim.emplace(eraseEntry(shard, it));
+    }
+    //already out of used_memory, a big victim is freed by LazyFree instead of under the shard lock
+    LazyFree::instance().dispose(std::move(*victim));
+    eviction.evicted_keys.fetch_add(1, std::memory_order_relaxed);
+    eviction.evicted_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return true;
+}
+
+std::string Database::memoryInfo() const {
+    size_t used = usedMemory();
+    std::ostringstream oss;
+    oss << "# Memory\r\n";
+    oss << "used_memory:" << used << "\r\n";
+    oss << "used_memory_human:" << humanBytes(used) << "\r\n";
+    oss << "maxmemory:" << eviction.maxmemory << "\r\n";
+    oss << "maxmemory_human:" << humanBytes(eviction.maxmemory) << "\r\n";
+    oss << "maxmemory_policy:" << evictionPolicyName(eviction.policy) << "\r\n";
+    oss << "maxmemory_samples:" << eviction.samples << "\r\n";
+    oss << "evicted_keys:" << eviction.evicted_keys.load(std::memory_order_relaxed) << "\r\n";
+    oss << "evicted_bytes:" << eviction.evicted_bytes.load(std::memory_order_relaxed) << "\r\n";
+    oss << "lazyfree_pending_objects:" << LazyFree::instance().pendingObjects() << "\r\n";
+    oss << "lazyfreed_objects:" << LazyFree::instance().freedObjects() << "\r\n";
+    return oss.str();
+}
@@ -0,0 +1,84 @@
+#include "../include/Glob.h"
+
+#include <cstddef>
+#include <utility>
+
+namespace {
+
+//[...] class starting at p[pos] == '[', sets end past the closing ] (or the pattern end)
+bool matchClass(std::string_view p, size_t pos, char c, size_t& end) {
+    size_t i = pos + 1;
+    bool negate = i < p.size() && p[i] == '^';
+    if (negate) i++;
+    bool found = false;
+    while (i < p.size() && p[i] != ']') {
+        if (p[i] == '\\' && i + 1 < p.size()) {
+            if (p[i + 1] == c) found = true;
+            i += 2;
+        } else if (i + 2 < p.size() && p[i + 1] == '-' && p[i + 2] != ']') {
+            unsigned char lo = p[i], hi = p[i + 2];
+            if (lo > hi) std::swap(lo, hi); //[z-a] == [a-z], like redis
+            unsigned char uc = c;
+            if (uc >= lo && uc <= hi) found = true;
+            i += 3;
+        } else {
+            if (p[i] == c) found = true;
+            i++;
+        }
+    }
+    end = i < p.size() ? i + 1 : i; //unterminated class runs to the end of the pattern
+    return found != negate;
+}
+
+//one non-* pattern element against c, next -> index after it
+bool matchOne(std::string_view p, size_t pos, char c, size_t& next) {
+    switch (p[pos]) {
+        case '?':
+            next = pos + 1;
+            return true;
+        case '[':
+            return matchClass(p, pos, c, next);
+        case '\\':
+            if (pos + 1 < p.size()) {
+                next = pos + 2;
+                return p[pos + 1] == c;
+            }
+            [[fallthrough]]; //trailing backslash is a literal one
+        default:
+            next = pos + 1;
+            return p[pos] == c;
+    }
+}
+
+} // namespace
+
+//greedy with a single restart point: on mismatch go back to the last * and let it eat one more char
+//earlier stars never need revisiting because the last one can absorb anything they could
+bool globMatch(std::string_view pattern, std::string_view text) {
+    size_t pi = 0, ti = 0;
+    size_t starPattern = std::string_view::npos, starText = 0;
+    while (ti < text.size()) {
+        if (pi < pattern.size() && pattern[pi] == '*') {
+            while (pi < pattern.size() && pattern[pi] == '*') pi++;
+            if (pi == pattern.size()) return true; //trailing * takes the rest
+            starPattern = pi;
+            starText = ti;
+            continue;
+        }
+        size_t next;
+        if (pi < pattern.size() && matchOne(pattern, pi, text[ti], next)) {
+            pi = next;
+            ti++;
+            continue;
+        }
+        if (starPattern == std::string_view::npos) return false;
+        pi = starPattern;
+        ti = ++starText;
+    }
+    while (pi < pattern.size() && pattern[pi] == '*') pi++;
+    return pi == pattern.size();
+}
+
+bool isGlobPattern(std::string_view pattern) {
+    return pattern.find_first_of("*?[\\") != std::string_view::npos;
+}
@@ -0,0 +1,58 @@
+#include "../include/LazyFree.h"
+
+#include <thread>
+
+//never destroyed -> the detached thread can not outlive it at exit
+LazyFree& LazyFree::instance() {
+    static LazyFree* lazyFree = new LazyFree();
+    return *lazyFree;
+}
+
+LazyFree::LazyFree() {
+    std::thread([this]() { run(); }).detach();
+}
+
+//a big string is one free, but unmapping it is per page -> every 64KB counts as one allocation
+size_t LazyFree::effort(const Value& value) {
+    switch (value.encoding) {
+        case ValueEncoding::QuickList: return value.list().nodeCount();
+        case ValueEncoding::HashTable: return value.hash().size();
+        case ValueEncoding::Raw: {
+            if (!value.isShared()) return 1;
+            const SharedString& shared = std::get<SharedString>(value.data);
+            return shared.use_count() > 1 ? 1 : 1 + shared->size() / (64 * 1024); //a reader keeps it alive anyway
+        }
+        default: return 1; //listpack -> one buffer
+    }
+}
+
+void LazyFree::dispose(Value&& value) {
+    if (effort(value) < THRESHOLD) return;
+    enqueue(std::make_unique<Owned<Value>>(std::move(value)));
+}
+
+void LazyFree::enqueue(std::unique_ptr<Garbage> garbage) {
+    pending.fetch_add(garbage->objects, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(garbage));
+    }
+    ready.notify_one();
+}
+
+//frees outside the mutex -> dispose never waits behind a big free
+void LazyFree::run() {
+    while (true) {
+        std::unique_ptr<Garbage> next;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return !queue.empty(); });
+            next = std::move(queue.front());
+            queue.pop_front();
+        }
+        size_t objects = next->objects;
+        next.reset();
+        pending.fetch_sub(objects, std::memory_order_relaxed);
+        freed.fetch_add(objects, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,226 @@
+#include "../include/ListPack.h"
+
+#include <cstring>
+
+//forward varint: 7 bits per byte, high bit -> more bytes follow
+static size_t varintSize(size_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static size_t writeVarint(char* p, size_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    p[n++] = static_cast<char>(v);
+    return n;
+}
+
+static size_t readVarint(const char* p, size_t& v) {
+    size_t n = 0;
+    unsigned shift = 0;
+    v = 0;
+    while (true) {
+        unsigned char b = static_cast<unsigned char>(p[n++]);
+        v |= static_cast<size_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+        shift += 7;
+    }
+    return n;
+}
+
+//backlen: same 7 bit groups but laid out so it is decoded from its last byte backwards
+static size_t writeBacklen(char* p, size_t v) {
+    size_t n = varintSize(v);
+    for (size_t i = 0; i < n; i++) {
+        unsigned char b = static_cast<unsigned char>((v >> (7 * i)) & 0x7F);
+        if (i + 1 < n) b |= 0x80;
+        p[n - 1 - i] = static_cast<char>(b);
+    }
+    return n;
+}
+
+//p points one past the backlen, returns bytes the backlen used
+static size_t readBacklen(const char* p, size_t& v) {
+    size_t n = 0;
+    unsigned shift = 0;
+    v = 0;
+    while (true) {
+        unsigned char b = static_cast<unsigned char>(*(p - 1 - n));
+        n++;
+        v |= static_cast<size_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+        shift += 7;
+    }
+    return n;
+}
+
+//bounds checked walk, every entry must end where its backlen says
+bool ListPack::assign(std::string_view bytes) {
+    const char* p = bytes.data();
+    size_t size = bytes.size();
+    size_t off = 0;
+    uint32_t n = 0;
+    while (off < size) {
+        size_t len = 0, used = 0;
+        unsigned shift = 0;
+        while (true) {
+            if (off + used >= size || shift > 56) return false;
+            unsigned char b = static_cast<unsigned char>(p[off + used++]);
+            len |= static_cast<size_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+            shift += 7;
+        }
+        size_t body = used + len;
+        if (len > size || body > size - off) return false;
+        size_t entryEnd = off + body + varintSize(body);
+        if (entryEnd > size) return false;
+        char back[10];
+        size_t backSize = writeBacklen(back, body);
+        if (memcmp(back, p + off + body, backSize) != 0) return false;
+        off = entryEnd;
+        n++;
+    }
+    buf.assign(bytes);
+    count = n;
+    return true;
+}
+
+size_t ListPack::entrySize(size_t len) {
+    size_t body = varintSize(len) + len;
+    return body + varintSize(body);
+}
+
+//caller already made room for entrySize(value.size()) bytes at offset
+void ListPack::encodeAt(size_t offset, std::string_view value) {
+    char* p = &buf[offset];
+    size_t n = writeVarint(p, value.size());
+    if (!value.empty()) memcpy(p + n, value.data(), value.size());
+    n += value.size();
+    writeBacklen(p + n, n);
+}
+
+void ListPack::pushBack(std::string_view value) {
+    size_t offset = buf.size();
+    buf.resize(offset + entrySize(value.size()));
+    encodeAt(offset, value);
+    count++;
+}
+
+void ListPack::pushFront(std::string_view value) {
+    insertAt(0, value);
+}
+
+void ListPack::insertAt(size_t offset, std::string_view value) {
+    buf.insert(offset, entrySize(value.size()), '\0'); //memmove of the tail, nodes are small
+    encodeAt(offset, value);
+    count++;
+}
+
+size_t ListPack::next(size_t offset) const {
+    size_t len;
+    size_t n = readVarint(buf.data() + offset, len);
+    size_t body = n + len;
+    return offset + body + varintSize(body);
+}
+
+size_t ListPack::prev(size_t offset) const {
+    size_t body;
+    size_t n = readBacklen(buf.data() + offset, body);
+    return offset - n - body;
+}
+
+std::string_view ListPack::get(size_t offset) const {
+    size_t len;
+    size_t n = readVarint(buf.data() + offset, len);
+    return std::string_view(buf.data() + offset + n, len);
+}
+
+size_t ListPack::offsetOf(size_t index) const {
+    if (index < count / 2) {
+        size_t off = first();
+        while (index--) off = next(off);
+        return off;
+    }
+    size_t off = end();
+    for (size_t i = count; i > index; i--) off = prev(off);
+    return off;
+}
+
+std::string ListPack::popFront() {
+    std::string value(get(first()));
+    erase(first());
+    return value;
+}
+
+std::string ListPack::popBack() {
+    size_t off = last();
+    std::string value(get(off));
+    buf.resize(off); //tail entry -> no memmove at all
+    count--;
+    return value;
+}
+
+void ListPack::replace(size_t offset, std::string_view value) {
+    size_t oldSize = next(offset) - offset;
+    size_t newSize = entrySize(value.size());
+    if (newSize != oldSize)
+        buf.replace(offset, oldSize, newSize, '\0');
+    encodeAt(offset, value);
+}
+
+size_t ListPack::erase(size_t offset) {
+    size_t entryEnd = next(offset);
+    buf.erase(offset, entryEnd - offset);
+    count--;
+    return offset;
+}
+
+size_t ListPack::removeMatching(std::string_view value, size_t limit, bool fromTail) {
+    size_t removed = 0;
+    if (!fromTail) {
+        size_t off = first();
+        while (off != end() && removed < limit) {
+            if (get(off) == value) {
+                off = erase(off);
+                removed++;
+            } else {
+                off = next(off);
+            }
+        }
+        return removed;
+    }
+    size_t off = end();
+    while (off != first() && removed < limit) {
+        off = prev(off);
+        if (get(off) == value) {
+            erase(off); //entries before off keep their offsets
+            removed++;
+        }
+    }
+    return removed;
+}
+
+void ListPack::keepRange(size_t start, size_t n) {
+    size_t from = offsetOf(start);
+    size_t to = from;
+    for (size_t i = 0; i < n; i++) to = next(to);
+    buf.erase(to);
+    buf.erase(0, from);
+    count = static_cast<uint32_t>(n);
+}
+
+ListPack ListPack::splitAt(size_t offset) {
+    ListPack tail;
+    for (size_t off = offset; off != end(); off = next(off)) tail.count++;
+    tail.buf.assign(buf, offset, std::string::npos);
+    buf.resize(offset);
+    count -= tail.count;
+    return tail;
+}
@@ -1,41 +1,96 @@
 #include <iostream>
 #include "../include/Server.h"
 #include "../include/Database.h"
+#include "../include/Config.h"
+#include "../include/Aof.h"
+#include "../include/CommandHandler.h"
+#include "../include/Slowlog.h"
+#include "../include/EventLoop.h"
 #include <thread>
 #include <chrono>
+#include <sys/stat.h>
 
 // screw the lambda function syntax using normal
+//background save -> forked child writes the snapshot, clients keep going
 void persistDatabase() {
     while(true){
         std::this_thread::sleep_for(std::chrono::seconds(300));
-        if(!Database::getInstance().dump("dump.my_rcb")){
-            std::cerr<<"error dumping database\n";
+        if(!Database::getInstance().bgsave("dump.my_rdb")){
+            std::cerr<<"background save already in progress, skipped\n";
         }
         else{
-            std::cout<<"database dumped to dump.my_rdb\n";
+            std::cout<<"background save of dump.my_rdb started\n";
         }
     }
 }
 
-// In main()
-std::thread persistanceThread(persistDatabase);
-
+//active expirer -> 10 cycles per second, each capped at 25ms of work (25% of one core at most)
+//lazy expiry on access still catches keys in between
+void activeExpire() {
+    const auto period = std::chrono::milliseconds(100);
+    const int64_t budgetUs = 25000;
+    while(true){
+        std::this_thread::sleep_for(period);
+        Database::getInstance().activeExpireCycle(budgetUs);
+    }
+}
 
 
 int main(int argc, char *argv[]){
-    int port = 6440;
-    if(argc >= 2) port = std::stoi(argv[1]);
+    Config config;
+    if(!parseArgs(argc, argv, config)){
+        std::cerr<<usage();
+        return 1;
+    }
+
+
+    Database::getInstance().configureShards(config.shards);
+    Slowlog::instance().configure(config.slowlog_log_slower_than, static_cast<size_t>(config.slowlog_max_len));
 
+    //before load -> restored hashes/lists get the same encoding as new ones
+    encodingLimits.list_max_listpack_entries = config.list_max_listpack_entries;
+    encodingLimits.list_max_listpack_value = config.list_max_listpack_value;
+    encodingLimits.hash_max_listpack_entries = config.hash_max_listpack_entries;
+    encodingLimits.hash_max_listpack_value = config.hash_max_listpack_value;
 
+    //append only file has every acknowledged write -> it wins over the snapshot when there is one
+    struct stat st;
+    bool haveAof = config.appendonly && stat("appendonly.aof", &st) == 0 && st.st_size > 0;
+    if(haveAof){
+        CommandHandler replayHandler;
+        uint64_t commands = 0;
+        auto start = std::chrono::steady_clock::now();
+        if(!AppendOnlyFile::replay("appendonly.aof", replayHandler, commands)){
+            std::cerr<<"appendonly.aof is corrupt, refusing to start\n";
+            return 1;
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout<<"replayed "<<commands<<" commands from appendonly.aof in "<<ms<<" ms\n";
+    }
     //singleton pattern trololo
-    if(Database::getInstance().load("dump.my_rdb")){
+    else if(Database::getInstance().load("dump.my_rdb")){
         std::cout<<"database loaded from dump.my_rdb\n";
     }
     else{
-        std::cout<<"no dump file found database not loaded \n";
+        std::cout<<"no usable dump file, database not loaded \n";
     }
 
-    Server server(port);
+    //after loading -> eviction never runs on a half loaded keyspace
+    EvictionPolicy evictionPolicy = EvictionPolicy::NoEviction;
+    parseEvictionPolicy(config.maxmemory_policy, evictionPolicy); //already validated by parseArgs
+    Database::getInstance().configureMemory(config.maxmemory, evictionPolicy, config.maxmemory_samples);
+
+    FsyncPolicy fsyncPolicy = FsyncPolicy::EverySec;
+    parseFsyncPolicy(config.appendfsync, fsyncPolicy); //already validated by parseArgs
+    AppendOnlyFile aof("appendonly.aof", fsyncPolicy, Database::getInstance().shardCount());
+    if(config.appendonly && !aof.open()){
+        return 1;
+    }
+
+    clientLimits.query_buffer = config.client_query_buffer_limit;
+    clientLimits.output_buffer = config.client_output_buffer_limit;
+
+    Server server(config.port, config.reactors);
 
     //dump database every 180 seconds
     std::thread persistanceThread(persistDatabase);
@@ -43,6 +98,9 @@ int main(int argc, char *argv[]){
     //so dont join this thread later, this thread run independently forever (evern main returns)
     persistanceThread.detach();
 
+    std::thread expireThread(activeExpire);
+    expireThread.detach();
+
     server.run();
     return 0;
 }
\ No newline at end of file
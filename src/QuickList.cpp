@@ -0,0 +1,164 @@
+#include "../include/QuickList.h"
+
+#include <algorithm>
+
+//a single huge element still gets a node of its own
+bool QuickList::fits(const ListPack& node, size_t len) {
+    return node.empty() || node.bytes() + ListPack::entrySize(len) <= NODE_MAX_BYTES;
+}
+
+void QuickList::pushFront(std::string_view value) {
+    if (nodes.empty() || !fits(nodes.front(), value.size()))
+        nodes.emplace_front();
+    nodes.front().pushFront(value);
+    used_bytes += ListPack::entrySize(value.size());
+    total++;
+}
+
+void QuickList::pushBack(std::string_view value) {
+    if (nodes.empty() || !fits(nodes.back(), value.size()))
+        nodes.emplace_back();
+    nodes.back().pushBack(value);
+    used_bytes += ListPack::entrySize(value.size());
+    total++;
+}
+
+bool QuickList::popFront(std::string& value) {
+    if (nodes.empty()) return false;
+    value = nodes.front().popFront();
+    used_bytes -= ListPack::entrySize(value.size());
+    if (nodes.front().empty()) nodes.pop_front();
+    total--;
+    return true;
+}
+
+bool QuickList::popBack(std::string& value) {
+    if (nodes.empty()) return false;
+    value = nodes.back().popBack();
+    used_bytes -= ListPack::entrySize(value.size());
+    if (nodes.back().empty()) nodes.pop_back();
+    total--;
+    return true;
+}
+
+bool QuickList::normalize(long idx, size_t& out) const {
+    if (idx < 0) idx += static_cast<long>(total);
+    if (idx < 0 || idx >= static_cast<long>(total)) return false;
+    out = static_cast<size_t>(idx);
+    return true;
+}
+
+//walk node counts from the nearer end
+std::list<ListPack>::const_iterator QuickList::locate(size_t idx, size_t& local) const {
+    if (idx < total / 2) {
+        auto it = nodes.begin();
+        while (idx >= it->size()) {
+            idx -= it->size();
+            ++it;
+        }
+        local = idx;
+        return it;
+    }
+    size_t fromTail = total - 1 - idx;
+    auto it = std::prev(nodes.end());
+    while (fromTail >= it->size()) {
+        fromTail -= it->size();
+        --it;
+    }
+    local = it->size() - 1 - fromTail;
+    return it;
+}
+
+std::list<ListPack>::iterator QuickList::locate(size_t idx, size_t& local) {
+    auto cit = static_cast<const QuickList*>(this)->locate(idx, local);
+    return nodes.erase(cit, cit); //const_iterator -> iterator without moving
+}
+
+bool QuickList::index(long idx, std::string& value) const {
+    size_t pos, local;
+    if (!normalize(idx, pos)) return false;
+    const ListPack& node = *locate(pos, local);
+    value.assign(node.get(node.offsetOf(local)));
+    return true;
+}
+
+bool QuickList::set(long idx, std::string_view value) {
+    size_t pos, local;
+    if (!normalize(idx, pos)) return false;
+    ListPack& node = *locate(pos, local);
+    size_t before = node.bytes();
+    node.replace(node.offsetOf(local), value);
+    used_bytes = used_bytes - before + node.bytes();
+    return true;
+}
+
+size_t QuickList::remove(std::string_view value, long count) {
+    size_t limit = count == 0 ? total : static_cast<size_t>(count < 0 ? -count : count);
+    size_t removed = 0;
+
+    if (count >= 0) {
+        for (auto it = nodes.begin(); it != nodes.end() && removed < limit; ) {
+            size_t before = it->bytes();
+            removed += it->removeMatching(value, limit - removed, false);
+            used_bytes = used_bytes - before + it->bytes();
+            it = it->empty() ? nodes.erase(it) : std::next(it);
+        }
+    } else {
+        for (auto it = nodes.end(); it != nodes.begin() && removed < limit; ) {
+            --it;
+            size_t before = it->bytes();
+            removed += it->removeMatching(value, limit - removed, true);
+            used_bytes = used_bytes - before + it->bytes();
+            if (it->empty()) it = nodes.erase(it);
+        }
+    }
+    total -= removed;
+    return removed;
+}
+
+void QuickList::trim(size_t start, size_t n) {
+    while (!nodes.empty() && start >= nodes.front().size()) {
+        start -= nodes.front().size();
+        used_bytes -= nodes.front().bytes();
+        nodes.pop_front();
+    }
+    //only the first and the last kept node get cut, the ones between stay as they are
+    size_t kept = 0;
+    auto it = nodes.begin();
+    for (; it != nodes.end() && kept < n; ++it) {
+        size_t from = (it == nodes.begin()) ? start : 0;
+        size_t take = std::min(it->size() - from, n - kept);
+        if (from != 0 || take != it->size()) {
+            size_t before = it->bytes();
+            it->keepRange(from, take);
+            used_bytes = used_bytes - before + it->bytes();
+        }
+        kept += take;
+    }
+    for (auto drop = it; drop != nodes.end(); ++drop) used_bytes -= drop->bytes();
+    nodes.erase(it, nodes.end());
+    total = kept;
+}
+
+bool QuickList::insert(std::string_view pivot, std::string_view value, bool after) {
+    for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+        for (size_t off = it->first(); off != it->end(); off = it->next(off)) {
+            if (it->get(off) != pivot) continue;
+            size_t at = after ? it->next(off) : off;
+            if (fits(*it, value.size())) {
+                it->insertAt(at, value);
+            } else {
+                //full node -> split at the insert point, value joins whichever half has room
+                ListPack tail = it->splitAt(at);
+                auto next = tail.empty() ? std::next(it) : nodes.insert(std::next(it), std::move(tail));
+                if (fits(*it, value.size())) it->pushBack(value);
+                else if (next != nodes.end() && fits(*next, value.size())) next->pushFront(value);
+                else nodes.emplace(next)->pushBack(value);
+            }
+            used_bytes += ListPack::entrySize(value.size()); //a split only moves bytes between nodes
+            total++;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,148 @@
+#include "../include/RespParser.h"
+
+#include <cstring>
+
+//same limits as redis -> a broken client can not make us buffer forever
+static const size_t MAX_INLINE_SIZE = 64 * 1024;
+static const long MAX_MULTIBULK_LEN = 1024 * 1024;
+static const long MAX_BULK_LEN = 512L * 1024 * 1024;
+
+//strict non negative decimal, no sign no spaces
+static bool parseLength(const char* p, size_t len, long& out) {
+    if (len == 0 || len > 18) return false;
+    long value = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] < '0' || p[i] > '9') return false;
+        value = value * 10 + (p[i] - '0');
+    }
+    out = value;
+    return true;
+}
+
+void RespParser::reset() {
+    cmd_start = 0;
+    cursor = 0;
+    multibulk_len = -1;
+    bulk_len = -1;
+    spans.clear();
+    err.clear();
+}
+
+void RespParser::discard(size_t n) {
+    cmd_start -= n;
+    cursor -= n;
+    for (auto& span : spans) span.first -= n;
+}
+
+size_t RespParser::sizeHint() const {
+    if (bulk_len < 0) return 0;
+    return cursor + bulk_len + 2;
+}
+
+ParseStatus RespParser::fail(const std::string& message) {
+    err = message;
+    return ParseStatus::Error;
+}
+
+void RespParser::finish(std::string_view buf, std::vector<std::string_view>& args) {
+    args.clear();
+    for (const auto& span : spans)
+        args.emplace_back(buf.data() + span.first, span.second);
+    spans.clear();
+    multibulk_len = -1;
+    bulk_len = -1;
+    cmd_start = cursor;
+}
+
+ParseStatus RespParser::parse(std::string_view buf, std::vector<std::string_view>& args) {
+    if (cursor >= buf.size()) return ParseStatus::Incomplete;
+    //new command -> first byte picks the protocol
+    if (multibulk_len < 0 && cursor == cmd_start && buf[cursor] != '*')
+        return parseInline(buf, args);
+    return parseMultibulk(buf, args);
+}
+
+// "SET a b\r\n" style, split by blanks like the old istringstream path
+ParseStatus RespParser::parseInline(std::string_view buf, std::vector<std::string_view>& args) {
+    const char* base = buf.data();
+    const char* nl = static_cast<const char*>(memchr(base + cursor, '\n', buf.size() - cursor));
+    if (!nl) {
+        if (buf.size() - cursor > MAX_INLINE_SIZE) return fail("too big inline request");
+        return ParseStatus::Incomplete;
+    }
+
+    size_t end = nl - base;
+    size_t lineEnd = end;
+    if (lineEnd > cursor && base[lineEnd - 1] == '\r') lineEnd--;
+
+    size_t i = cursor;
+    while (i < lineEnd) {
+        while (i < lineEnd && (base[i] == ' ' || base[i] == '\t')) i++;
+        size_t start = i;
+        while (i < lineEnd && base[i] != ' ' && base[i] != '\t') i++;
+        if (i > start) spans.emplace_back(start, i - start);
+    }
+    cursor = end + 1;
+    finish(buf, args);
+    return ParseStatus::Complete; //empty line -> empty args, caller skips it
+}
+
+ParseStatus RespParser::parseMultibulk(std::string_view buf, std::vector<std::string_view>& args) {
+    const char* base = buf.data();
+
+    if (multibulk_len < 0) {
+        //"*<n>\r\n"
+        const char* cr = static_cast<const char*>(memchr(base + cursor, '\r', buf.size() - cursor));
+        if (!cr) {
+            if (buf.size() - cursor > MAX_INLINE_SIZE) return fail("too big mbulk count string");
+            return ParseStatus::Incomplete;
+        }
+        size_t crPos = cr - base;
+        if (crPos + 1 >= buf.size()) return ParseStatus::Incomplete; //'\n' not here yet
+
+        long count;
+        if (!parseLength(base + cursor + 1, crPos - cursor - 1, count) || count > MAX_MULTIBULK_LEN)
+            return fail("invalid multibulk length");
+        cursor = crPos + 2;
+        if (count == 0) {
+            finish(buf, args);
+            return ParseStatus::Complete;
+        }
+        multibulk_len = count;
+        spans.reserve(count);
+    }
+
+    while (multibulk_len > 0) {
+        if (bulk_len < 0) {
+            //"$<len>\r\n"
+            if (cursor >= buf.size()) return ParseStatus::Incomplete;
+            const char* cr = static_cast<const char*>(memchr(base + cursor, '\r', buf.size() - cursor));
+            if (!cr) {
+                if (buf.size() - cursor > MAX_INLINE_SIZE) return fail("too big bulk count string");
+                return ParseStatus::Incomplete;
+            }
+            if (base[cursor] != '$')
+                return fail(std::string("expected '$', got '") + base[cursor] + "'");
+            size_t crPos = cr - base;
+            if (crPos + 1 >= buf.size()) return ParseStatus::Incomplete;
+
+            long len;
+            if (!parseLength(base + cursor + 1, crPos - cursor - 1, len) || len > MAX_BULK_LEN)
+                return fail("invalid bulk length");
+            cursor = crPos + 2;
+            bulk_len = len;
+        }
+
+        //payload + trailing CRLF
+        if (buf.size() - cursor < static_cast<size_t>(bulk_len) + 2) return ParseStatus::Incomplete;
+        if (base[cursor + bulk_len] != '\r' || base[cursor + bulk_len + 1] != '\n')
+            return fail("bulk string not terminated by CRLF");
+        spans.emplace_back(cursor, bulk_len);
+        cursor += bulk_len + 2;
+        bulk_len = -1;
+        multibulk_len--;
+    }
+
+    finish(buf, args);
+    return ParseStatus::Complete;
+}
@@ -0,0 +1,216 @@
+#include "../include/RespWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+
+//---------- OutputBuffer ----------
+
+std::string& OutputBuffer::tailChunk() {
+    if (!segments.empty() && segments.back().chunk) {
+        std::string& tail = segments.back().bytes;
+        if (tail.size() < tail.capacity()) return tail;
+    }
+    std::string fresh = std::move(spare);
+    spare = std::string();
+    fresh.clear();
+    fresh.reserve(CHUNK_SIZE);
+    segments.push_back({std::move(fresh), true, nullptr});
+    return segments.back().bytes;
+}
+
+//fills the tail chunk up to its capacity, spills into new chunks -> no realloc of sent bytes
+void OutputBuffer::append(std::string_view bytes) {
+    pending += bytes.size();
+    while (!bytes.empty()) {
+        std::string& tail = tailChunk();
+        size_t n = std::min(tail.capacity() - tail.size(), bytes.size());
+        tail.append(bytes.data(), n);
+        bytes.remove_prefix(n);
+    }
+}
+
+void OutputBuffer::append(std::string&& bytes) {
+    if (bytes.size() < BIG_VALUE) {
+        append(std::string_view(bytes));
+        return;
+    }
+    pending += bytes.size();
+    segments.push_back({std::move(bytes), false, nullptr});
+}
+
+void OutputBuffer::append(std::shared_ptr<const std::string> bytes) {
+    if (bytes->size() < BIG_VALUE) {
+        append(std::string_view(*bytes));
+        return;
+    }
+    pending += bytes->size();
+    segments.push_back({std::string(), false, std::move(bytes)});
+}
+
+int OutputBuffer::gather(iovec* iov, int max) const {
+    int n = 0;
+    size_t skip = head_offset;
+    for (auto it = segments.begin(); it != segments.end() && n < max; ++it) {
+        std::string_view bytes = it->view();
+        if (bytes.size() > skip) {
+            iov[n].iov_base = const_cast<char*>(bytes.data() + skip);
+            iov[n].iov_len = bytes.size() - skip;
+            n++;
+        }
+        skip = 0;
+    }
+    return n;
+}
+
+void OutputBuffer::consume(size_t n) {
+    pending -= n;
+    while (n > 0 && !segments.empty()) {
+        Segment& front = segments.front();
+        size_t left = front.view().size() - head_offset;
+        if (n < left) {
+            head_offset += n;
+            return;
+        }
+        n -= left;
+        if (front.chunk && segments.size() == 1) { //drained tail chunk stays as the next tail, no deque churn
+            front.bytes.clear();
+            head_offset = 0;
+            return;
+        }
+        if (front.chunk && spare.capacity() < CHUNK_SIZE) spare = std::move(front.bytes);
+        segments.pop_front();
+        head_offset = 0;
+    }
+}
+
+void OutputBuffer::clear() {
+    for (auto& seg : segments) {
+        if (seg.chunk && spare.capacity() < CHUNK_SIZE) spare = std::move(seg.bytes);
+    }
+    segments.clear();
+    head_offset = 0;
+    pending = 0;
+}
+
+//only called before anything past size was sent -> whole segments go, the last one kept is cut
+void OutputBuffer::truncate(size_t size) {
+    while (pending > size && !segments.empty()) {
+        Segment& back = segments.back();
+        size_t len = back.view().size() - (segments.size() == 1 ? head_offset : 0);
+        size_t drop = pending - size;
+        if (drop < len) {
+            if (back.shared) {
+                back.bytes.assign(back.shared->data(), back.shared->size() - drop);
+                back.shared.reset();
+            } else {
+                back.bytes.resize(back.bytes.size() - drop);
+            }
+            pending = size;
+            return;
+        }
+        pending -= len;
+        if (back.chunk && spare.capacity() < CHUNK_SIZE) spare = std::move(back.bytes);
+        segments.pop_back();
+        if (segments.empty()) head_offset = 0;
+    }
+}
+
+std::string OutputBuffer::str() const {
+    std::string all;
+    all.reserve(pending);
+    size_t skip = head_offset;
+    for (const auto& seg : segments) {
+        all.append(seg.view().substr(skip));
+        skip = 0;
+    }
+    return all;
+}
+
+//---------- RespWriter ----------
+
+namespace {
+
+//"*n\r\n", "$n\r\n", ":n\r\n" for every n below CACHED_HEADERS, built once
+struct HeaderCache {
+    std::array<std::array<std::string, RespWriter::CACHED_HEADERS>, 3> text;
+
+    HeaderCache() {
+        const char types[3] = {'*', '$', ':'};
+        for (size_t t = 0; t < 3; t++) {
+            for (size_t n = 0; n < RespWriter::CACHED_HEADERS; n++)
+                text[t][n] = types[t] + std::to_string(n) + "\r\n";
+        }
+    }
+};
+
+const HeaderCache& headerCache() {
+    static const HeaderCache cache;
+    return cache;
+}
+
+int cacheRow(char type) {
+    return type == '*' ? 0 : type == '$' ? 1 : 2;
+}
+
+} // namespace
+
+void RespWriter::header(char type, long long value) {
+    if (value >= 0 && static_cast<size_t>(value) < CACHED_HEADERS) {
+        out.append(std::string_view(headerCache().text[cacheRow(type)][value]));
+        return;
+    }
+    char buf[24];
+    buf[0] = type;
+    char* end = std::to_chars(buf + 1, buf + sizeof(buf) - 2, value).ptr;
+    *end++ = '\r';
+    *end++ = '\n';
+    out.append(std::string_view(buf, end - buf));
+}
+
+void RespWriter::simple(std::string_view text) {
+    out.append(std::string_view("+"));
+    out.append(text);
+    out.append(std::string_view("\r\n"));
+}
+
+void RespWriter::error(std::string_view message) {
+    error_count++;
+    out.append(std::string_view("-"));
+    out.append(message);
+    out.append(std::string_view("\r\n"));
+}
+
+void RespWriter::integer(long long value) {
+    header(':', value);
+}
+
+void RespWriter::bulk(std::string_view value) {
+    header('$', static_cast<long long>(value.size()));
+    out.append(value);
+    out.append(std::string_view("\r\n"));
+}
+
+void RespWriter::bulk(std::string&& value) {
+    header('$', static_cast<long long>(value.size()));
+    out.append(std::move(value));
+    out.append(std::string_view("\r\n"));
+}
+
+void RespWriter::bulk(std::shared_ptr<const std::string> value) {
+    header('$', static_cast<long long>(value->size()));
+    out.append(std::move(value));
+    out.append(std::string_view("\r\n"));
+}
+
+void RespWriter::null() {
+    out.append(std::string_view("$-1\r\n"));
+}
+
+void RespWriter::nullArray() {
+    out.append(std::string_view("*-1\r\n"));
+}
+
+void RespWriter::arrayHeader(size_t count) {
+    header('*', static_cast<long long>(count));
+}
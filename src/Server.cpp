@@ -1,61 +1,184 @@
 #include "../include/Server.h"
 #include "../include/CommandHandler.h"
 #include "../include/Database.h"
+#include "../include/EventLoop.h"
+#include "../include/Aof.h"
+#include "../include/Stats.h"
 #include <iostream>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <netinet/in.h>
-#include <vector>
-#include <thread>
-#include <cstring>
 #include <signal.h>
+#include <sstream>
+#include <mutex>
+#include <array>
+#include <chrono>
 
 
 //created global pointer (signal handling)
 static Server* globalServer = nullptr;
 
-void signalHandler(int signum){
-    if(globalServer){
-        std::cout<<"\n came signal "<<signum<<", shutting down.. \n";
-        globalServer->shutdown();
-    }
-    //returning signum integer to os after exit obv not exit(0)
-    exit(signum);
+//may interrupt a reactor holding a shard lock -> only flags + eventfd writes here
+//run() returns, joins the reactors and does the dump / aof close on the normal path
+void signalHandler(int /*signum*/){
+    if(globalServer) globalServer->shutdown();
 }
 
 void Server::setupSignalHandler() {
     signal(SIGINT, signalHandler);
 }
-Server::Server(int port) : port(port), server_socket(-1), running(true){
+Server::Server(int port, int reactors) : port(port), reactor_count(reactors < 1 ? 1 : reactors), running(true){
     globalServer = this;
     setupSignalHandler();
 }
 
+Server::~Server() = default;
+
+//async signal safe: atomic store + eventfd write per loop, nothing that locks or allocates
 void Server::shutdown(){
-    //socket server shutdown
     running = false; //atomic op
-    if(server_socket != -1){
-        //persisting database
-        if(Database::getInstance().dump("dump.my_rdb")){
-            std::cout<<"persistance process success \n";
-        }
-        else{
-            std::cerr<<"Error dumping database \n";
-        }
-        close(server_socket); //close sys call
+    for (size_t i = 0; i < loops.size(); i++) loops[i]->stop(); //wake every epoll_wait so the reactors return
+}
+
+std::string Server::reactorInfo(){
+    std::ostringstream oss;
+    oss << "# Reactors\r\n";
+    if(!globalServer) return oss.str();
+    oss << "reactors:" << globalServer->loops.size() << "\r\n";
+    for (const auto& loop : globalServer->loops) {
+        const ReactorStats& st = loop->stats();
+        oss << "reactor" << loop->id()
+            << ":connected_clients=" << st.connected_clients.load(std::memory_order_relaxed)
+            << ",total_connections=" << st.total_connections.load(std::memory_order_relaxed)
+            << ",total_commands=" << st.total_commands.load(std::memory_order_relaxed)
+            << "\r\n";
     }
-    std::cout<<"server shutdown complete \n";
+    return oss.str();
 }
 
-void Server::run(){
-    server_socket = socket(AF_INET, SOCK_STREAM, 0);
+//reactor counters summed, the reactors keep writing while this reads
+namespace {
+struct ReactorTotals {
+    uint64_t connected_clients = 0;
+    uint64_t total_connections = 0;
+    uint64_t total_commands = 0;
+    uint64_t net_input_bytes = 0;
+    uint64_t net_output_bytes = 0;
+};
+}
+
+static ReactorTotals sumReactors(const std::vector<std::unique_ptr<EventLoop>>& loops) {
+    ReactorTotals sum;
+    for (const auto& loop : loops) {
+        const ReactorStats& st = loop->stats();
+        sum.connected_clients += st.connected_clients.load(std::memory_order_relaxed);
+        sum.total_connections += st.total_connections.load(std::memory_order_relaxed);
+        sum.total_commands += st.total_commands.load(std::memory_order_relaxed);
+        sum.net_input_bytes += st.net_input_bytes.load(std::memory_order_relaxed);
+        sum.net_output_bytes += st.net_output_bytes.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+//instantaneous rates like redis -> a sample every 100ms, averaged over the last 16 (1.6s window)
+namespace {
+struct RateSamples {
+    static const size_t WINDOW = 16;
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point last;
+    uint64_t last_commands = 0;
+    uint64_t last_input = 0;
+    uint64_t last_output = 0;
+    std::array<double, WINDOW> ops{};
+    std::array<double, WINDOW> input{};
+    std::array<double, WINDOW> output{};
+    size_t next = 0;
+
+    static double average(const std::array<double, WINDOW>& samples) {
+        double sum = 0;
+        for (double v : samples) sum += v;
+        return sum / WINDOW;
+    }
+};
+RateSamples rates;
+}
+
+void Server::sampleStats() {
+    if (!globalServer) return;
+    ReactorTotals sum = sumReactors(globalServer->loops);
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(rates.mutex);
+    if (rates.last.time_since_epoch().count() != 0) {
+        double seconds = std::chrono::duration<double>(now - rates.last).count();
+        if (seconds <= 0) return;
+        rates.ops[rates.next] = static_cast<double>(sum.total_commands - rates.last_commands) / seconds;
+        rates.input[rates.next] = static_cast<double>(sum.net_input_bytes - rates.last_input) / seconds;
+        rates.output[rates.next] = static_cast<double>(sum.net_output_bytes - rates.last_output) / seconds;
+        rates.next = (rates.next + 1) % RateSamples::WINDOW;
+    }
+    rates.last = now;
+    rates.last_commands = sum.total_commands;
+    rates.last_input = sum.net_input_bytes;
+    rates.last_output = sum.net_output_bytes;
+}
+
+std::string Server::clientsInfo(){
+    ReactorTotals sum = globalServer ? sumReactors(globalServer->loops) : ReactorTotals{};
+    std::ostringstream oss;
+    oss << "# Clients\r\n"
+        << "connected_clients:" << sum.connected_clients << "\r\n";
+    return oss.str();
+}
+
+std::string Server::statsInfo(){
+    ReactorTotals sum = globalServer ? sumReactors(globalServer->loops) : ReactorTotals{};
+    ThreadTotals threads = threadTotals();
+    uint64_t errorReplies = threads.unknown_commands;
+    for (const CommandTotals& cmd : commandTotals()) errorReplies += cmd.failed + cmd.rejected;
+
+    double opsPerSec, inputKbps, outputKbps;
+    {
+        std::lock_guard<std::mutex> lock(rates.mutex);
+        opsPerSec = RateSamples::average(rates.ops);
+        inputKbps = RateSamples::average(rates.input) / 1024;
+        outputKbps = RateSamples::average(rates.output) / 1024;
+    }
+
+    std::ostringstream oss;
+    oss << "# Stats\r\n"
+        << "total_connections_received:" << sum.total_connections << "\r\n"
+        << "total_commands_processed:" << sum.total_commands << "\r\n"
+        << "instantaneous_ops_per_sec:" << static_cast<uint64_t>(opsPerSec + 0.5) << "\r\n"
+        << "total_net_input_bytes:" << sum.net_input_bytes << "\r\n"
+        << "total_net_output_bytes:" << sum.net_output_bytes << "\r\n";
+    oss.setf(std::ios::fixed);
+    oss.precision(2);
+    oss << "instantaneous_input_kbps:" << inputKbps << "\r\n"
+        << "instantaneous_output_kbps:" << outputKbps << "\r\n"
+        << "total_error_replies:" << errorReplies << "\r\n"
+        << "unknown_commands:" << threads.unknown_commands << "\r\n"
+        << "shard_lock_waits:" << threads.lock_waits << "\r\n"
+        << "shard_lock_wait_usec:" << threads.lock_wait_ns / 1000 << "\r\n";
+    return oss.str();
+}
+
+//every reactor owns its own listener bound to the same port
+//SO_REUSEPORT -> kernel hashes incoming connections across them
+int Server::createListener(){
+    //non blocking listener -> edge triggered accept loop drains it until EAGAIN
+    int server_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if(server_socket < 0){
         std::cerr<<"can not create socket \n";
-        return;
+        return -1;
     }
 
     int opt = 1; //option level for tcp protocol going to be used in socket
     setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if(setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0){
+        std::cerr<<"SO_REUSEPORT not supported \n";
+        close(server_socket);
+        return -1;
+    }
 
     sockaddr_in serverAddr{}; //sockaddr_in struct instance for socket config
     
@@ -65,52 +188,74 @@ void Server::run(){
 
     if(bind(server_socket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0){
         std::cerr<<"socket bind failed in server \n";
-        return;
+        close(server_socket);
+        return -1;
     }
 
-    //max pending connections -> 10
+    //max pending connections -> SOMAXCONN
     //making socket passive -> later on accept sys call
-    //clien::connect() and server::accept() connection between these sates are backlog thats why set 10
-    if(listen(server_socket, 10) < 0){
+    //clien::connect() and server::accept() connection between these sates are backlog, thousands of clients can connect in a burst
+    if(listen(server_socket, SOMAXCONN) < 0){
         std::cerr<<"server listen errror \n";
-        return;
+        close(server_socket);
+        return -1;
     }
+    return server_socket;
+}
 
-    std::cout<<" server listening on port "<<port<<"\n";
+void Server::run(){
+    for (int i = 0; i < reactor_count; i++) {
+        int fd = createListener();
+        if (fd < 0) {
+            for (int open_fd : listen_sockets) close(open_fd);
+            listen_sockets.clear();
+            return;
+        }
+        listen_sockets.push_back(fd);
+    }
 
-    std::vector<std::thread> threads;
-    CommandHandler cmdHandler; //implement later 
+    std::cout<<" server listening on port "<<port<<" with "<<reactor_count<<" reactor(s)\n";
 
-    while (running) {
-        int client_socket = accept(server_socket, nullptr, nullptr);
-        if (client_socket < 0) {
-            if (running) 
-                std::cerr << "Error Accepting Client Connection\n";
-            break;
-        }
+    cmdHandler = std::make_unique<CommandHandler>();
 
-        //setup a beautiful thread lol for this shit
-        threads.emplace_back([client_socket, &cmdHandler](){
-            char buffer[1024]; //buffer to recv client msg
-            while (true) {
-                memset(buffer, 0, sizeof(buffer)); //set buffer memory block to 0
-                int bytes = recv(client_socket, buffer, sizeof(buffer) - 1, 0); //recv sys call
-                if (bytes <= 0) break; //if recv return bytes count <= 0
-                std::string request(buffer, bytes); //might read garbage in string request thats why bytes must be specified
-                std::string response = cmdHandler.processCommand(request);
-                send(client_socket, response.c_str(), response.size(), 0);
-            }
-            close(client_socket);
-        });
+    //build every loop before starting any thread -> loops vector never changes while reactors run
+    //reserved -> a signal arriving meanwhile never sees the vector reallocate
+    loops.reserve(reactor_count);
+    for (int i = 0; i < reactor_count; i++) {
+        loops.push_back(std::make_unique<EventLoop>(i, listen_sockets[i], *cmdHandler));
     }
-    
-    for (auto& t : threads) {
+
+    //reactor 0 runs on this thread, the rest get one thread each
+    for (int i = 1; i < reactor_count; i++) {
+        EventLoop* loop = loops[i].get();
+        reactor_threads.emplace_back([loop](){ loop->run(); });
+    }
+    //reads the loops -> only started once they all exist
+    std::thread sampler([this](){
+        while (running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            sampleStats();
+        }
+    });
+
+    //signal before this point -> running already false, the loop returns right away
+    if (running) loops[0]->run();
+    std::cout << "\n shutting down.. \n";
+    shutdown(); //loop 0 may have returned on its own (epoll failure), stop the others too
+
+    for (auto& t : reactor_threads) {
         if (t.joinable()) t.join();
     }
+    sampler.join();
 
-    // Before shutdown, persist the database
+    //no reactor left -> nobody holds a shard lock, safe to persist
     if (Database::getInstance().dump("dump.my_rdb"))
         std::cout << "Database Dumped to dump.my_rdb\n";
     else 
         std::cerr << "Error dumping database\n";
-}
\ No newline at end of file
+    //last appended writes to disk, reactors joined -> no command holds an order lock or the aof mutex
+    if (AppendOnlyFile* aof = AppendOnlyFile::active()) aof->close();
+    for (int fd : listen_sockets) close(fd); //close sys call
+    listen_sockets.clear();
+    std::cout << "server shutdown complete \n";
+}
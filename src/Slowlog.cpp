@@ -0,0 +1,72 @@
+#include "../include/Slowlog.h"
+
+#include <chrono>
+#include <algorithm>
+
+Slowlog& Slowlog::instance() {
+    static Slowlog log;
+    return log;
+}
+
+void Slowlog::configure(int64_t slowerThanUs, size_t maxLen) {
+    threshold.store(slowerThanUs, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex);
+    max_len = maxLen;
+    ring.clear();
+    head = 0;
+    count = 0;
+}
+
+void Slowlog::record(const std::vector<std::string_view>& args, uint64_t durationUs, std::string_view client) {
+    SlowlogEntry entry;
+    entry.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    entry.duration_us = durationUs;
+    entry.client.assign(client);
+
+    //big MSETs / values would pin a lot of memory in the ring otherwise
+    size_t kept = args.size() > MAX_ARGS ? MAX_ARGS - 1 : args.size();
+    entry.args.reserve(kept + (args.size() > kept));
+    for (size_t i = 0; i < kept; i++) {
+        std::string_view arg = args[i];
+        if (arg.size() <= MAX_ARG_LEN) {
+            entry.args.emplace_back(arg);
+            continue;
+        }
+        std::string cut(arg.substr(0, MAX_ARG_LEN));
+        cut += "... (" + std::to_string(arg.size() - MAX_ARG_LEN) + " more bytes)";
+        entry.args.push_back(std::move(cut));
+    }
+    if (args.size() > kept)
+        entry.args.push_back("... (" + std::to_string(args.size() - kept) + " more arguments)");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (max_len == 0) return;
+    entry.id = next_id++;
+    if (ring.size() < max_len) ring.resize(max_len);
+    ring[head] = std::move(entry);
+    head = (head + 1) % max_len;
+    count = std::min(count + 1, max_len);
+}
+
+std::vector<SlowlogEntry> Slowlog::newest(size_t n) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    n = std::min(n, count);
+    std::vector<SlowlogEntry> entries;
+    entries.reserve(n);
+    for (size_t i = 1; i <= n; i++)
+        entries.push_back(ring[(head + max_len - i) % max_len]);
+    return entries;
+}
+
+size_t Slowlog::length() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+void Slowlog::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ring.clear(); //frees the entries, slots come back on the next record
+    head = 0;
+    count = 0;
+}
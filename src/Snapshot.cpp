@@ -0,0 +1,755 @@
+#include "../include/Database.h"
+#include "../include/Crc64.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// binary snapshot, version 2, integers little endian
+//
+// header  : "VRTXSNAP" | u16 version | u16 reserved | u32 shards | u64 keys | i64 created ms | u64 crc64(header)
+// section : 'S' | u64 keys | u64 payload bytes | payload | u64 crc64(payload)   -> one per shard
+// index   : 'I' | u32 sections | sections x (u64 offset, u64 payload bytes, u64 keys) | u64 crc64(entries)
+// trailer : 'E' | u32 sections | u64 index offset   -> fixed 13 bytes at the very end
+//
+// the index lets the loader find every section without walking the file, so sections are
+// decoded on all cores at once; version 1 files (no index, 5 byte trailer) are walked instead
+//
+// payload entry : u8 type | u8 encoding | i64 expire_at | str key | body
+//   Raw       -> str
+//   ListPack  -> str of the raw listpack bytes (list items or hash field,value pairs), loaded with one copy
+//   QuickList -> u64 count | count x str
+//   HashTable -> u64 pairs | pairs x (str field, str value)
+// str = varint length + bytes -> any byte can be in a key or value
+//
+// every length is checked against the mapped file, a bad crc or short read fails the whole load
+
+static const char SNAPSHOT_MAGIC[8] = {'V', 'R', 'T', 'X', 'S', 'N', 'A', 'P'};
+static const uint16_t SNAPSHOT_VERSION = 2;
+static const size_t HEADER_SIZE = 8 + 2 + 2 + 4 + 8 + 8; //crc not included
+static const size_t SECTION_HEADER_SIZE = 1 + 8 + 8;
+static const size_t TRAILER_SIZE = 1 + 4 + 8;
+
+//where one section lives in the file
+struct SectionInfo {
+    uint64_t offset; //of the 'S' tag
+    uint64_t length; //payload bytes
+    uint64_t keys;
+};
+
+//---------- writing ----------
+
+static void putLE(std::string& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+static void putVarint(std::string& out, size_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+static void putStr(std::string& out, std::string_view s) {
+    putVarint(out, s.size());
+    out.append(s);
+}
+
+static void encodeEntry(std::string& out, std::string_view key, const Value& value) {
+    out.push_back(static_cast<char>(value.type));
+    out.push_back(static_cast<char>(value.encoding));
+    putLE(out, static_cast<uint64_t>(value.expire_at), 8);
+    putStr(out, key);
+    switch (value.encoding) {
+        case ValueEncoding::Raw:
+            putStr(out, value.str());
+            break;
+        case ValueEncoding::ListPack:
+            putStr(out, value.pack().raw());
+            break;
+        case ValueEncoding::QuickList:
+            putLE(out, value.list().size(), 8);
+            value.list().forEach([&out](std::string_view item) { putStr(out, item); });
+            break;
+        case ValueEncoding::HashTable:
+            putLE(out, value.hash().size(), 8);
+            for (const auto& kv : value.hash()) {
+                putStr(out, kv.first);
+                putStr(out, kv.second);
+            }
+            break;
+    }
+}
+
+//write() until everything is out, EINTR retried
+static bool writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+//never write over the live file -> temp in the same directory, renamed once complete
+static std::string tempName(const std::string& filename, pid_t pid) {
+    return filename + ".tmp-" + std::to_string(pid);
+}
+
+//rename only changes the directory -> without this the new name can be gone after a power loss
+bool syncParentDir(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+static uint64_t elapsedUs(std::chrono::steady_clock::time_point since) {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now() - since).count();
+}
+
+bool Database::writeSnapshot(const std::string& path, uint64_t& bytes) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;//if no permission return false
+
+    int64_t now = nowMs();
+    uint64_t totalKeys = 0;
+    for (const auto& shard : shards) totalKeys += shard->dict.size(); //hint for the loader, may include expired
+
+    std::string buf;
+    buf.append(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    putLE(buf, SNAPSHOT_VERSION, 2);
+    putLE(buf, 0, 2);
+    putLE(buf, shards.size(), 4);
+    putLE(buf, totalKeys, 8);
+    putLE(buf, static_cast<uint64_t>(now), 8);
+    putLE(buf, crc64(0, buf.data(), buf.size()), 8);
+    bool ok = writeAll(fd, buf.data(), buf.size());
+    bytes = buf.size();
+
+    //one section per shard, payload buffer reused -> no allocation per key
+    std::string payload;
+    std::vector<SectionInfo> index;
+    index.reserve(shards.size());
+    for (const auto& shard : shards) {
+        if (!ok) break;
+        payload.clear();
+        uint64_t keys = 0;
+        for (const auto& kv : shard->dict) {
+            if (kv.second.isExpired(now)) continue;
+            encodeEntry(payload, kv.first, kv.second);
+            keys++;
+        }
+        index.push_back({bytes, payload.size(), keys});
+        buf.clear();
+        buf.push_back('S');
+        putLE(buf, keys, 8);
+        putLE(buf, payload.size(), 8);
+        ok = writeAll(fd, buf.data(), buf.size()) && writeAll(fd, payload.data(), payload.size());
+        bytes += buf.size() + payload.size();
+        buf.clear();
+        putLE(buf, crc64(0, payload.data(), payload.size()), 8);
+        ok = ok && writeAll(fd, buf.data(), buf.size());
+        bytes += buf.size();
+    }
+
+    uint64_t indexOffset = bytes;
+    buf.clear();
+    buf.push_back('I');
+    putLE(buf, index.size(), 4);
+    size_t entriesStart = buf.size();
+    for (const auto& section : index) {
+        putLE(buf, section.offset, 8);
+        putLE(buf, section.length, 8);
+        putLE(buf, section.keys, 8);
+    }
+    putLE(buf, crc64(0, buf.data() + entriesStart, buf.size() - entriesStart), 8);
+    buf.push_back('E');
+    putLE(buf, index.size(), 4);
+    putLE(buf, indexOffset, 8);
+    ok = ok && writeAll(fd, buf.data(), buf.size());
+    bytes += buf.size();
+    ok = ok && fsync(fd) == 0; //data on disk before the rename makes it visible
+    close(fd);
+    return ok;
+}
+
+void Database::recordSave(bool ok, uint64_t durationUs, uint64_t bytes, uint64_t stallUs) {
+    auto& st = save_stats;
+    st.last_ok.store(ok, std::memory_order_relaxed);
+    st.last_stall_us.store(stallUs, std::memory_order_relaxed);
+    if (stallUs > st.max_stall_us.load(std::memory_order_relaxed))
+        st.max_stall_us.store(stallUs, std::memory_order_relaxed);
+    if (!ok) {
+        st.failed_saves.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    st.saves.fetch_add(1, std::memory_order_relaxed);
+    st.last_save_ms.store(nowMs(), std::memory_order_relaxed);
+    st.last_duration_us.store(durationUs, std::memory_order_relaxed);
+    st.last_bytes.store(bytes, std::memory_order_relaxed);
+}
+
+//foreground save, writers wait until it is on disk
+bool Database::dump(const std::string& filename) {
+    auto start = std::chrono::steady_clock::now();
+    std::string tmp = tempName(filename, getpid());
+    uint64_t bytes = 0;
+    bool ok;
+    {
+        auto locks = lockAllShared(); //consistent view of every shard, readers keep going
+        ok = writeSnapshot(tmp, bytes);
+    }
+    uint64_t stall = elapsedUs(start);
+    ok = ok && ::rename(tmp.c_str(), filename.c_str()) == 0 && syncParentDir(filename);
+    if (!ok) unlink(tmp.c_str());
+    recordSave(ok, elapsedUs(start), bytes, stall);
+    return ok;
+}
+
+bool Database::bgsave(const std::string& filename) {
+    if (save_stats.in_progress.exchange(true)) return false;
+    std::thread([this, filename]() {
+        runBgsave(filename);
+        save_stats.in_progress.store(false);
+    }).detach();
+    return true;
+}
+
+//fork gives the child a frozen copy of the keyspace (copy on write pages), parent carries on serving
+pid_t Database::forkChild(const std::function<bool()>& work) {
+    //no writer may be half way through a shard when the address space is copied
+    auto locks = lockAllExclusive();
+    pid_t pid = fork();
+    if (pid == 0) {
+        //child: only this thread exists, the locks it inherited are never touched again
+        signal(SIGINT, SIG_DFL); //ctrl+c must not run the server shutdown in here
+        _exit(work() ? 0 : 1);
+    }
+    return pid;
+}
+
+void Database::runBgsave(const std::string& filename) {
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = forkChild([this, &filename]() {
+        uint64_t bytes;
+        return writeSnapshot(tempName(filename, getpid()), bytes);
+    });
+    uint64_t stall = elapsedUs(start);
+    if (pid < 0) {
+        std::cerr << "bgsave: fork failed: " << strerror(errno) << "\n";
+        recordSave(false, 0, 0, stall);
+        return;
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    std::string tmp = tempName(filename, pid);
+    struct stat st;
+    uint64_t bytes = stat(tmp.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && ::rename(tmp.c_str(), filename.c_str()) == 0 &&
+              syncParentDir(filename);
+    if (!ok) {
+        unlink(tmp.c_str());
+        std::cerr << "bgsave: child failed, " << filename << " left untouched\n";
+    }
+    recordSave(ok, elapsedUs(start), bytes, stall);
+}
+
+//---------- command log ----------
+
+static void putBulk(std::string& out, std::string_view s) {
+    out.push_back('$');
+    out.append(std::to_string(s.size()));
+    out.append("\r\n");
+    out.append(s);
+    out.append("\r\n");
+}
+
+static void putArray(std::string& out, size_t n) {
+    out.push_back('*');
+    out.append(std::to_string(n));
+    out.append("\r\n");
+}
+
+static const size_t ITEMS_PER_COMMAND = 64; //big lists/hashes -> several RPUSH/HMSET, replay never builds a huge arg vector
+
+bool Database::writeCommands(const std::string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    int64_t now = nowMs();
+    std::string out;
+    bool ok = true;
+    for (const auto& shard : shards) {
+        for (const auto& kv : shard->dict) {
+            const std::string& key = kv.first;
+            const Value& value = kv.second;
+            if (value.isExpired(now)) continue;
+            switch (value.type) {
+                case ValueType::String:
+                    putArray(out, 3);
+                    putBulk(out, "SET");
+                    putBulk(out, key);
+                    putBulk(out, value.str());
+                    break;
+                case ValueType::List: {
+                    size_t left = value.listSize(), batch = 0;
+                    value.listForEach([&](std::string_view item) {
+                        if (batch == 0) {
+                            batch = std::min(left, ITEMS_PER_COMMAND);
+                            left -= batch;
+                            putArray(out, 2 + batch);
+                            putBulk(out, "RPUSH");
+                            putBulk(out, key);
+                        }
+                        putBulk(out, item);
+                        batch--;
+                    });
+                    break;
+                }
+                case ValueType::Hash: {
+                    size_t left = value.hashSize(), batch = 0;
+                    value.hashForEach([&](std::string_view field, std::string_view val) {
+                        if (batch == 0) {
+                            batch = std::min(left, ITEMS_PER_COMMAND);
+                            left -= batch;
+                            putArray(out, 2 + 2 * batch);
+                            putBulk(out, "HMSET");
+                            putBulk(out, key);
+                        }
+                        putBulk(out, field);
+                        putBulk(out, val);
+                        batch--;
+                    });
+                    break;
+                }
+            }
+            if (value.hasExpire()) {
+                putArray(out, 3);
+                putBulk(out, "PEXPIREAT");
+                putBulk(out, key);
+                putBulk(out, std::to_string(value.expire_at));
+            }
+            if (out.size() >= 1 << 20) {
+                ok = ok && writeAll(fd, out.data(), out.size());
+                out.clear();
+            }
+        }
+    }
+    ok = ok && writeAll(fd, out.data(), out.size());
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+bool Database::writeCommandLog(const std::string& path) {
+    auto locks = lockAllShared();
+    return writeCommands(path);
+}
+
+pid_t Database::forkCommandLog(const std::string& path) {
+    return forkChild([this, &path]() { return writeCommands(path); });
+}
+
+std::string Database::persistenceInfo() const {
+    const auto& st = save_stats;
+    std::ostringstream oss;
+    oss << "# Persistence\r\n";
+    oss << "bgsave_in_progress:" << (st.in_progress.load(std::memory_order_relaxed) ? 1 : 0) << "\r\n";
+    oss << "last_save_status:" << (st.last_ok.load(std::memory_order_relaxed) ? "ok" : "err") << "\r\n";
+    oss << "last_save_time_ms:" << st.last_save_ms.load(std::memory_order_relaxed) << "\r\n";
+    oss << "saves:" << st.saves.load(std::memory_order_relaxed) << "\r\n";
+    oss << "failed_saves:" << st.failed_saves.load(std::memory_order_relaxed) << "\r\n";
+    oss << "last_save_duration_us:" << st.last_duration_us.load(std::memory_order_relaxed) << "\r\n";
+    oss << "last_save_bytes:" << st.last_bytes.load(std::memory_order_relaxed) << "\r\n";
+    oss << "last_save_stall_us:" << st.last_stall_us.load(std::memory_order_relaxed) << "\r\n";
+    oss << "max_save_stall_us:" << st.max_stall_us.load(std::memory_order_relaxed) << "\r\n";
+    return oss.str();
+}
+
+//---------- reading ----------
+
+//bounds checked cursor over the mapped file
+struct SnapshotReader {
+    const char* p;
+    const char* end;
+
+    bool bytes(size_t n, const char*& out) {
+        if (static_cast<size_t>(end - p) < n) return false;
+        out = p;
+        p += n;
+        return true;
+    }
+    bool le(int n, uint64_t& v) {
+        const char* b;
+        if (!bytes(n, b)) return false;
+        v = 0;
+        for (int i = 0; i < n; i++) v |= static_cast<uint64_t>(static_cast<unsigned char>(b[i])) << (8 * i);
+        return true;
+    }
+    bool varint(size_t& v) {
+        v = 0;
+        for (unsigned shift = 0; shift <= 63; shift += 7) {
+            if (p == end) return false;
+            unsigned char b = static_cast<unsigned char>(*p++);
+            v |= static_cast<size_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+    bool str(std::string_view& s) {
+        size_t len;
+        const char* b;
+        if (!varint(len) || !bytes(len, b)) return false;
+        s = std::string_view(b, len);
+        return true;
+    }
+};
+
+//key stays a view into the mapped file, only copied when it goes into the dict
+static bool decodeEntry(SnapshotReader& in, std::string_view& key, Value& value) {
+    uint64_t type, encoding, expireAt;
+    if (!in.le(1, type) || !in.le(1, encoding) || !in.le(8, expireAt) || !in.str(key)) return false;
+
+    switch (static_cast<ValueEncoding>(encoding)) {
+        case ValueEncoding::Raw: {
+            std::string_view s;
+            if (type != static_cast<uint64_t>(ValueType::String) || !in.str(s)) return false;
+            value = Value::makeString(s);
+            break;
+        }
+        case ValueEncoding::ListPack: {
+            std::string_view raw;
+            if (!in.str(raw)) return false;
+            if (type == static_cast<uint64_t>(ValueType::List)) value = Value::makeList();
+            else if (type == static_cast<uint64_t>(ValueType::Hash)) value = Value::makeHash();
+            else return false;
+            if (!value.pack().assign(raw)) return false;
+            if (value.type == ValueType::Hash && value.pack().size() % 2 != 0) return false;
+            break;
+        }
+        case ValueEncoding::QuickList: {
+            uint64_t count;
+            if (type != static_cast<uint64_t>(ValueType::List) || !in.le(8, count)) return false;
+            value = Value{.type = ValueType::List, .encoding = ValueEncoding::QuickList, .data = ListValue{}};
+            for (uint64_t i = 0; i < count; i++) {
+                std::string_view item;
+                if (!in.str(item)) return false;
+                value.list().pushBack(item);
+            }
+            break;
+        }
+        case ValueEncoding::HashTable: {
+            uint64_t pairs;
+            if (type != static_cast<uint64_t>(ValueType::Hash) || !in.le(8, pairs)) return false;
+            if (pairs > static_cast<uint64_t>(in.end - in.p) / 2) return false; //each pair is >= 2 bytes
+            value = Value{.type = ValueType::Hash, .encoding = ValueEncoding::HashTable, .data = std::make_unique<HashValue>()};
+            value.hash().reserve(pairs); //buckets sized once
+            for (uint64_t i = 0; i < pairs; i++) {
+                std::string_view field, val;
+                if (!in.str(field) || !in.str(val)) return false;
+                if (value.hash().emplace(std::string(field), std::string(val)).second)
+                    value.hash().payload += stringHeapBytes(field.size()) + stringHeapBytes(val.size());
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+    value.expire_at = static_cast<int64_t>(expireAt);
+    return true;
+}
+
+//version 2 -> read the index footer
+static bool readIndex(const char* data, size_t size, uint64_t sections, std::vector<SectionInfo>& index) {
+    if (size < HEADER_SIZE + 8 + TRAILER_SIZE) return false;
+    SnapshotReader trailer{data + size - TRAILER_SIZE, data + size};
+    uint64_t tag, count, indexOffset;
+    if (!trailer.le(1, tag) || !trailer.le(4, count) || !trailer.le(8, indexOffset)) return false;
+    if (tag != 'E' || count != sections || indexOffset >= size - TRAILER_SIZE) return false;
+
+    SnapshotReader in{data + indexOffset, data + size - TRAILER_SIZE};
+    uint64_t n, storedCrc;
+    const char* entries;
+    if (!in.le(1, tag) || tag != 'I' || !in.le(4, n) || n != sections ||
+        n > (size / 24) || !in.bytes(n * 24, entries) || !in.le(8, storedCrc) ||
+        storedCrc != crc64(0, entries, n * 24))
+        return false;
+    SnapshotReader e{entries, entries + n * 24};
+    index.resize(n);
+    for (auto& section : index) {
+        if (!e.le(8, section.offset) || !e.le(8, section.length) || !e.le(8, section.keys)) return false;
+        //section must sit entirely before the index
+        if (section.offset > indexOffset || section.length > indexOffset - section.offset ||
+            indexOffset - section.offset - section.length < SECTION_HEADER_SIZE + 8)
+            return false;
+    }
+    return true;
+}
+
+//version 1 -> no index, hop from section header to section header
+static bool walkSections(const char* data, size_t size, uint64_t sections, std::vector<SectionInfo>& index) {
+    SnapshotReader in{data + HEADER_SIZE + 8, data + size};
+    index.resize(sections);
+    for (auto& section : index) {
+        uint64_t tag;
+        const char* skip;
+        section.offset = static_cast<uint64_t>(in.p - data);
+        if (!in.le(1, tag) || tag != 'S' || !in.le(8, section.keys) || !in.le(8, section.length) ||
+            !in.bytes(section.length + 8, skip))
+            return false;
+    }
+    uint64_t tag, count;
+    return in.le(1, tag) && tag == 'E' && in.le(4, count) && count == sections;
+}
+
+//one decoded entry, waiting for the insert phase
+struct LoadedEntry {
+    std::string key;
+    Value value;
+};
+
+bool Database::loadBinary(const char* data, size_t size) {
+    using namespace std::chrono;
+    auto decodeStart = steady_clock::now();
+
+    SnapshotReader in{data, data + size};
+    const char* header;
+    if (!in.bytes(HEADER_SIZE, header)) return false;
+    uint64_t storedCrc;
+    if (!in.le(8, storedCrc) || storedCrc != crc64(0, header, HEADER_SIZE)) {
+        std::cerr << "snapshot: header checksum mismatch\n";
+        return false;
+    }
+    SnapshotReader hdr{header + sizeof(SNAPSHOT_MAGIC), header + HEADER_SIZE};
+    uint64_t version = 0, sections = 0;
+    hdr.le(2, version);
+    hdr.p += 2;  //reserved
+    hdr.le(4, sections);
+    //key count + creation time: informational, the index has exact per section counts
+    if (version != 1 && version != SNAPSHOT_VERSION) {
+        std::cerr << "snapshot: unsupported version " << version << "\n";
+        return false;
+    }
+
+    std::vector<SectionInfo> index;
+    if (!(version == 1 ? walkSections(data, size, sections, index) : readIndex(data, size, sections, index))) {
+        std::cerr << "snapshot: bad section index\n";
+        return false;
+    }
+
+    //decode: sections handed out to workers, each sorts its entries by destination shard
+    //decoded[section][shard] -> the insert phase can give every shard to exactly one thread
+    size_t shardTotal = shards.size();
+    std::vector<std::vector<std::vector<LoadedEntry>>> decoded(index.size());
+    std::atomic<size_t> nextSection{0};
+    std::atomic<bool> failed{false};
+    int64_t now = nowMs();
+
+    auto decodeWorker = [&]() {
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t s = nextSection.fetch_add(1);
+            if (s >= index.size()) return;
+            const SectionInfo& section = index[s];
+            SnapshotReader hdrIn{data + section.offset, data + size};
+            uint64_t tag, keys, length, sectionCrc;
+            const char* payload;
+            if (!hdrIn.le(1, tag) || tag != 'S' || !hdrIn.le(8, keys) || !hdrIn.le(8, length) ||
+                keys != section.keys || length != section.length ||
+                !hdrIn.bytes(length, payload) || !hdrIn.le(8, sectionCrc) ||
+                sectionCrc != crc64(0, payload, length)) {
+                std::cerr << "snapshot: checksum mismatch in section " << s << "\n";
+                failed = true;
+                return;
+            }
+
+            auto& buckets = decoded[s];
+            buckets.resize(shardTotal);
+            SnapshotReader body{payload, payload + length};
+            for (uint64_t k = 0; k < keys; k++) {
+                std::string_view key;
+                Value value = Value::makeString(std::string_view());
+                if (!decodeEntry(body, key, value)) {
+                    std::cerr << "snapshot: corrupt entry in section " << s << "\n";
+                    failed = true;
+                    return;
+                }
+                if (value.isExpired(now)) continue; //died while we were down
+                buckets[shardIndex(key)].push_back({std::string(key), std::move(value)});
+            }
+            if (body.p != body.end) {
+                std::cerr << "snapshot: trailing bytes in section " << s << "\n";
+                failed = true;
+                return;
+            }
+        }
+    };
+
+    size_t threads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), index.size()));
+    auto runParallel = [threads](const std::function<void()>& work) {
+        std::vector<std::thread> pool;
+        for (size_t t = 1; t < threads; t++) pool.emplace_back(work);
+        work(); //this thread works too
+        for (auto& th : pool) th.join();
+    };
+    runParallel(decodeWorker);
+    if (failed) return false;
+    auto insertStart = steady_clock::now();
+
+    //insert: one thread per destination shard, no two threads ever touch the same dict
+    std::atomic<size_t> nextShard{0};
+    runParallel([&]() {
+        while (true) {
+            size_t t = nextShard.fetch_add(1);
+            if (t >= shardTotal) return;
+            Shard& shard = *shards[t];
+            size_t count = 0;
+            for (const auto& buckets : decoded) count += buckets[t].size();
+            shard.dict.reserve(count); //buckets sized once -> no rehash while loading
+            for (auto& buckets : decoded) {
+                for (auto& entry : buckets[t]) {
+                    if (entry.value.hasExpire())
+                        shard.expires.push_back({entry.value.expire_at, entry.key});
+                    shard.dict.insert_or_assign(std::move(entry.key), std::move(entry.value));
+                }
+                std::vector<LoadedEntry>().swap(buckets[t]);
+            }
+            //heap built once instead of a push_heap per key
+            std::make_heap(shard.expires.begin(), shard.expires.end(), std::greater<ExpireEntry>());
+            recountMemory(shard);
+        }
+    });
+
+    uint64_t loaded = 0;
+    for (const auto& shard : shards) loaded += shard->dict.size();
+    std::cout << "snapshot: " << loaded << " keys from " << index.size() << " sections, decode "
+              << duration_cast<milliseconds>(insertStart - decodeStart).count() << " ms on " << threads
+              << " threads, insert " << duration_cast<milliseconds>(steady_clock::now() - insertStart).count()
+              << " ms\n";
+    return true;
+}
+
+/*
+old text dump, still accepted so an upgrade keeps its data (no expiry, no spaces in values)
+
+Key-Value (K)
+K name jaggi
+
+List (L)
+L fruits apple banana orange
+
+Hash (H)
+H user:100 name:jaggi age:21
+*/
+bool Database::loadText(const std::string& filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) return false;
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+        std::istringstream iss(line);
+        char type;
+        iss >> type;
+        if (type == 'K') {
+            std::string key, value;
+            iss >> key >> value;
+            shardFor(key).dict.insert_or_assign(key, Value::makeString(value));
+        } else if (type == 'L') {
+            std::string key;
+            iss >> key;
+            std::string item;
+            Value list = Value::makeList();
+            while (iss >> item)
+                list.listPushBack(item);
+            shardFor(key).dict.insert_or_assign(key, std::move(list));
+        } else if (type == 'H') {
+            std::string key;
+            iss >> key;
+            Value hash = Value::makeHash();
+            std::string pair;
+            while (iss >> pair) {
+                auto pos = pair.find(':');
+                if (pos != std::string::npos) {
+                    std::string field = pair.substr(0, pos);
+                    std::string value = pair.substr(pos+1);
+                    hash.hashSet(field, value);
+                }
+            }
+            shardFor(key).dict.insert_or_assign(key, std::move(hash));
+        }
+    }
+    for (auto& shard : shards) recountMemory(*shard);
+    return true;
+}
+
+bool Database::load(const std::string& filename) {
+    auto locks = lockAllExclusive();
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    for (auto& shard : shards) {
+        shard->dict.clear();
+        shard->expires.clear();
+        shard->volatile_keys = 0;
+        shard->used_memory.store(0, std::memory_order_relaxed);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size < sizeof(SNAPSHOT_MAGIC)) {
+        close(fd);
+        return loadText(filename);
+    }
+
+    //map + fault in the whole file up front -> the read phase is pure I/O, decode never waits on the disk
+    auto readStart = std::chrono::steady_clock::now();
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    std::cout << "snapshot: read " << size << " bytes in " << elapsedUs(readStart) / 1000 << " ms\n";
+
+    const char* data = static_cast<const char*>(map);
+    bool ok;
+    if (memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0) {
+        ok = loadBinary(data, size);
+    } else {
+        ok = loadText(filename);
+    }
+    munmap(map, size);
+
+    if (!ok) {
+        //never start half loaded
+        for (auto& shard : shards) {
+            shard->dict.clear();
+            shard->expires.clear();
+            shard->volatile_keys = 0;
+            shard->used_memory.store(0, std::memory_order_relaxed);
+        }
+    }
+    return ok;
+}
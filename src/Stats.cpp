@@ -0,0 +1,129 @@
+#include "../include/Stats.h"
+#include "../include/CommandHandler.h"
+
+#include <mutex>
+#include <cmath>
+#include <cstdio>
+
+//---------- latency buckets ----------
+
+size_t LatencyBuckets::of(uint64_t ns) {
+    if (ns < LINEAR) return static_cast<size_t>(ns);
+    unsigned exp = 63 - __builtin_clzll(ns); //>= SUB_BITS + 1
+    if (exp >= MAX_EXP) return COUNT - 1;
+    size_t sub = (ns >> (exp - SUB_BITS)) & ((size_t(1) << SUB_BITS) - 1);
+    return LINEAR + (exp - SUB_BITS - 1) * (size_t(1) << SUB_BITS) + sub;
+}
+
+uint64_t LatencyBuckets::high(size_t bucket) {
+    if (bucket < LINEAR) return bucket;
+    size_t rel = bucket - LINEAR;
+    unsigned exp = static_cast<unsigned>(rel >> SUB_BITS) + SUB_BITS + 1;
+    uint64_t sub = rel & ((size_t(1) << SUB_BITS) - 1);
+    uint64_t low = ((uint64_t(1) << SUB_BITS) + sub) << (exp - SUB_BITS);
+    return low + (uint64_t(1) << (exp - SUB_BITS)) - 1;
+}
+
+uint64_t CommandTotals::percentileNs(double p) const {
+    if (calls == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(calls)));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < latency.size(); b++) {
+        seen += latency[b];
+        if (seen >= rank) return LatencyBuckets::high(b);
+    }
+    return LatencyBuckets::high(latency.size() - 1);
+}
+
+//---------- per thread registry ----------
+
+namespace {
+
+//every ThreadStats ever handed out, never freed -> counts survive their thread and pointers stay valid
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadStats>>& registry() {
+    static std::vector<std::unique_ptr<ThreadStats>> all;
+    return all;
+}
+
+ThreadStats* registerThread() {
+    auto stats = std::make_unique<ThreadStats>();
+    stats->commands.reset(new CommandStats[commandCount()]);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry().push_back(std::move(stats));
+    return registry().back().get();
+}
+
+} // namespace
+
+ThreadStats& threadStats() {
+    thread_local ThreadStats* mine = registerThread();
+    return *mine;
+}
+
+std::vector<CommandTotals> commandTotals() {
+    std::vector<CommandTotals> totals(commandCount());
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& thread : registry()) {
+        for (size_t i = 0; i < totals.size(); i++) {
+            const CommandStats& cs = thread->commands[i];
+            CommandTotals& t = totals[i];
+            uint64_t calls = cs.calls.get();
+            if (calls == 0 && cs.rejected.get() == 0) continue;
+            t.calls += calls;
+            t.failed += cs.failed.get();
+            t.rejected += cs.rejected.get();
+            t.ns += cs.ns.get();
+            for (size_t b = 0; b < LatencyBuckets::COUNT; b++) t.latency[b] += cs.latency[b].get();
+        }
+    }
+    return totals;
+}
+
+ThreadTotals threadTotals() {
+    ThreadTotals totals;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& thread : registry()) {
+        totals.unknown_commands += thread->unknown_commands.get();
+        totals.lock_waits += thread->lock_waits.get();
+        totals.lock_wait_ns += thread->lock_wait_ns.get();
+    }
+    return totals;
+}
+
+//---------- INFO sections ----------
+
+std::string commandStatsInfo() {
+    std::vector<CommandTotals> totals = commandTotals();
+    std::string info = "# Commandstats\r\n";
+    char line[256];
+    for (size_t i = 0; i < totals.size(); i++) {
+        const CommandTotals& t = totals[i];
+        if (t.calls == 0 && t.rejected == 0) continue;
+        double usec = static_cast<double>(t.ns) / 1000.0;
+        std::string_view name = commandAt(i).name;
+        std::snprintf(line, sizeof(line), "cmdstat_%.*s:calls=%llu,usec=%llu,usec_per_call=%.2f,rejected_calls=%llu,failed_calls=%llu\r\n",
+                      static_cast<int>(name.size()), name.data(), static_cast<unsigned long long>(t.calls),
+                      static_cast<unsigned long long>(t.ns / 1000), t.calls ? usec / static_cast<double>(t.calls) : 0.0,
+                      static_cast<unsigned long long>(t.rejected), static_cast<unsigned long long>(t.failed));
+        info += line;
+    }
+    return info;
+}
+
+std::string latencyStatsInfo() {
+    std::vector<CommandTotals> totals = commandTotals();
+    std::string info = "# Latencystats\r\n";
+    char line[256];
+    for (size_t i = 0; i < totals.size(); i++) {
+        const CommandTotals& t = totals[i];
+        if (t.calls == 0) continue;
+        std::string_view name = commandAt(i).name;
+        std::snprintf(line, sizeof(line), "latency_percentiles_usec_%.*s:p50=%.3f,p99=%.3f,p99.9=%.3f\r\n",
+                      static_cast<int>(name.size()), name.data(), static_cast<double>(t.percentileNs(50)) / 1000.0,
+                      static_cast<double>(t.percentileNs(99)) / 1000.0, static_cast<double>(t.percentileNs(99.9)) / 1000.0);
+        info += line;
+    }
+    return info;
+}
@@ -0,0 +1,217 @@
+#include "../include/Value.h"
+
+EncodingLimits encodingLimits;
+
+//---------- list ----------
+
+size_t Value::listSize() const {
+    return encoding == ValueEncoding::ListPack ? pack().size() : list().size();
+}
+
+//move every item into a QuickList, never goes back (redis does the same)
+void Value::listConvert() {
+    ListValue big;
+    pack().forEach([&big](std::string_view item) { big.pushBack(item); });
+    data = std::move(big);
+    encoding = ValueEncoding::QuickList;
+}
+
+void Value::listPushFront(std::string_view item) {
+    if (encoding == ValueEncoding::ListPack) {
+        if (pack().size() < encodingLimits.list_max_listpack_entries &&
+            item.size() <= encodingLimits.list_max_listpack_value) {
+            pack().pushFront(item);
+            return;
+        }
+        listConvert();
+    }
+    list().pushFront(item);
+}
+
+void Value::listPushBack(std::string_view item) {
+    if (encoding == ValueEncoding::ListPack) {
+        if (pack().size() < encodingLimits.list_max_listpack_entries &&
+            item.size() <= encodingLimits.list_max_listpack_value) {
+            pack().pushBack(item);
+            return;
+        }
+        listConvert();
+    }
+    list().pushBack(item);
+}
+
+bool Value::listPopFront(std::string& item) {
+    if (encoding != ValueEncoding::ListPack) return list().popFront(item);
+    if (pack().empty()) return false;
+    item = pack().popFront();
+    return true;
+}
+
+bool Value::listPopBack(std::string& item) {
+    if (encoding != ValueEncoding::ListPack) return list().popBack(item);
+    if (pack().empty()) return false;
+    item = pack().popBack();
+    return true;
+}
+
+//negative -> from the tail, false when out of range
+static bool normalizeIndex(long idx, size_t size, size_t& out) {
+    if (idx < 0) idx += static_cast<long>(size);
+    if (idx < 0 || idx >= static_cast<long>(size)) return false;
+    out = static_cast<size_t>(idx);
+    return true;
+}
+
+bool Value::listIndex(long idx, std::string& item) const {
+    if (encoding != ValueEncoding::ListPack) return list().index(idx, item);
+    size_t pos;
+    if (!normalizeIndex(idx, pack().size(), pos)) return false;
+    item.assign(pack().get(pack().offsetOf(pos)));
+    return true;
+}
+
+bool Value::listSet(long idx, std::string_view item) {
+    if (encoding == ValueEncoding::ListPack) {
+        size_t pos;
+        if (!normalizeIndex(idx, pack().size(), pos)) return false;
+        if (item.size() <= encodingLimits.list_max_listpack_value) {
+            pack().replace(pack().offsetOf(pos), item);
+            return true;
+        }
+        listConvert();
+    }
+    return list().set(idx, item);
+}
+
+size_t Value::listRemove(std::string_view item, long count) {
+    if (encoding != ValueEncoding::ListPack) return list().remove(item, count);
+    size_t limit = count == 0 ? pack().size() : static_cast<size_t>(count < 0 ? -count : count);
+    return pack().removeMatching(item, limit, count < 0);
+}
+
+void Value::listTrim(size_t start, size_t n) {
+    if (encoding == ValueEncoding::ListPack) pack().keepRange(start, n);
+    else list().trim(start, n);
+}
+
+bool Value::listInsert(std::string_view pivot, std::string_view item, bool after) {
+    if (encoding == ValueEncoding::ListPack) {
+        ListPack& lp = pack();
+        size_t off = lp.first();
+        while (off != lp.end() && lp.get(off) != pivot) off = lp.next(off);
+        if (off == lp.end()) return false;
+        if (lp.size() < encodingLimits.list_max_listpack_entries &&
+            item.size() <= encodingLimits.list_max_listpack_value) {
+            lp.insertAt(after ? lp.next(off) : off, item);
+            return true;
+        }
+        listConvert();
+    }
+    return list().insert(pivot, item, after);
+}
+
+//---------- hash ----------
+//listpack layout: field, value, field, value ... -> lookups are a linear scan, fine for <= 128 pairs
+
+size_t Value::hashSize() const {
+    return encoding == ValueEncoding::ListPack ? pack().size() / 2 : hash().size();
+}
+
+size_t Value::packFind(std::string_view field) const {
+    const ListPack& lp = pack();
+    for (size_t off = lp.first(); off != lp.end(); off = lp.next(lp.next(off))) {
+        if (lp.get(off) == field) return off;
+    }
+    return lp.end();
+}
+
+void Value::hashConvert() {
+    auto big = std::make_unique<HashValue>();
+    big->reserve(pack().size() / 2 + 1);
+    hashForEach([&big](std::string_view field, std::string_view value) {
+        big->emplace(std::string(field), std::string(value));
+        big->payload += stringHeapBytes(field.size()) + stringHeapBytes(value.size());
+    });
+    data = std::move(big);
+    encoding = ValueEncoding::HashTable;
+}
+
+bool Value::hashGet(std::string_view field, std::string& value) const {
+    if (encoding == ValueEncoding::ListPack) {
+        size_t off = packFind(field);
+        if (off == pack().end()) return false;
+        value.assign(pack().get(pack().next(off)));
+        return true;
+    }
+    auto it = hash().find(field);
+    if (it == hash().end()) return false;
+    value = it->second;
+    return true;
+}
+
+bool Value::hashExists(std::string_view field) const {
+    if (encoding == ValueEncoding::ListPack) return packFind(field) != pack().end();
+    return hash().find(field) != hash().end();
+}
+
+void Value::hashSet(std::string_view field, std::string_view value) {
+    if (encoding == ValueEncoding::ListPack) {
+        bool small = field.size() <= encodingLimits.hash_max_listpack_value &&
+                     value.size() <= encodingLimits.hash_max_listpack_value;
+        size_t off = packFind(field);
+        if (small && off != pack().end()) {
+            pack().replace(pack().next(off), value); //overwrite keeps the pair count
+            return;
+        }
+        if (small && pack().size() / 2 < encodingLimits.hash_max_listpack_entries) {
+            pack().pushBack(field);
+            pack().pushBack(value);
+            return;
+        }
+        hashConvert();
+    }
+    HashValue& table = hash();
+    auto it = table.find(field);
+    if (it != table.end()) {
+        table.payload = table.payload - stringHeapBytes(it->second.size()) + stringHeapBytes(value.size());
+        it->second = value;
+    } else {
+        table.emplace(std::string(field), std::string(value));
+        table.payload += stringHeapBytes(field.size()) + stringHeapBytes(value.size());
+    }
+}
+
+bool Value::hashDel(std::string_view field) {
+    if (encoding == ValueEncoding::ListPack) {
+        size_t off = packFind(field);
+        if (off == pack().end()) return false;
+        pack().erase(pack().erase(off)); //field, then the value that slid into its place
+        return true;
+    }
+    HashValue& table = hash();
+    auto it = table.find(field);
+    if (it == table.end()) return false;
+    table.payload -= stringHeapBytes(it->first.size()) + stringHeapBytes(it->second.size());
+    table.erase(it);
+    table.rehashStep(); //hashes get no cron -> HDELs move a shrink along
+    return true;
+}
+
+//---------- memory ----------
+
+size_t Value::memoryUsage() const {
+    switch (encoding) {
+        case ValueEncoding::Raw:
+            if (isShared()) //make_shared block: refcounts + std::string, then the bytes
+                return 2 * sizeof(void*) + sizeof(std::string) + stringHeapBytes(str().size());
+            return stringHeapBytes(std::get<std::string>(data).capacity());
+        case ValueEncoding::ListPack:
+            return pack().bytes();
+        case ValueEncoding::QuickList:
+            return list().bytes();
+        case ValueEncoding::HashTable:
+            return sizeof(HashValue) + hash().bucketCount() * sizeof(void*) +
+                   hash().size() * HashValue::NODE_BYTES + hash().payload;
+    }
+    return 0;
+}